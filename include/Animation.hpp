@@ -25,49 +25,116 @@
 #ifndef ANIMATION_HPP
 #define ANIMATION_HPP
 
+#include "AnimationWriter.hpp"
+
+#include <cstdint>
 #include <memory>
 #include <functional>
 #include <string>
 
 
+/**
+ * @brief The Animation class writes the frames to the file as they are
+ * added, through the AnimationWriter for the file format.
+ * A frame with the same pixels as the one before it is not written again,
+ * the one before is shown for longer instead. Frames are told apart by a
+ * hash of their pixels.
+ * Frames that the writer holds until finish() may be spilled to a scratch
+ * file, from which an export that did not finish is resumed. The file is
+ * removed on cancel(), unless asked to keep it.
+ * Usage: open(uri), addFrame() for each frame, then finish() or cancel().
+ */
 class Animation {
 public:
 	typedef unsigned char byte;
 	typedef std::function<bool(unsigned frame)> OnFrameAdded;
-	enum PixelFormat { RGBA, RGB };
+	typedef AnimationWriter::PixelFormat PixelFormat;
 
-	Animation(OnFrameAdded callback = nullptr, PixelFormat format = RGBA);
+	Animation(OnFrameAdded callback = nullptr,
+			  PixelFormat format = AnimationWriter::RGBA);
 
 	~Animation();
 
+
+	/**
+	 * @brief open starts writing an animation to 'uri'.
+	 * @param uri the filename, its extension picks the format.
+	 * @return true if successful.
+	 */
+	bool open(const std::string& uri);
+
+
+	/**
+	 * @brief spill sets whether the next animations opened keep the frames
+	 * that wait for finish() in a scratch file rather than in memory.
+	 */
+	void spill(const bool state);
+
+	bool spill() const;
+
+
+	/**
+	 * @brief resume takes up, right after open(), the animation left
+	 * unfinished at the same uri by an export with the same 'key'.
+	 * @param key identifies the animation, see hash().
+	 * @return the number of frames already added, 0 if there is nothing
+	 * to resume.
+	 */
+	unsigned resume(const uint64_t key);
+
+
 	/**
 	 * @brief addFrame add a frame to this animation
 	 * @param w the width in pixels
 	 * @param h the height in pixels
 	 * @param bytes the image data rgba
-	 * @param delay the duration of this frame in milliseconds
+	 * @param delay the duration of this frame in 1/100 s
+	 * @param keep whether the frame is to be repeated by repeatFrame().
 	 * @return true if the frame was created successfully.
 	 */
 	bool addFrame(unsigned w,
 				  unsigned h,
 				  const byte* bytes,
-				  unsigned delay);
+				  unsigned delay,
+				  bool keep = false);
 
-	unsigned frameCount();
 
-	void clear();
+	/**
+	 * @brief repeatFrame adds again a frame added before and kept.
+	 * @param frame the index of that frame, the first frame being 0.
+	 * @param delay the duration of this frame in 1/100 s
+	 * @return true if the frame was created successfully.
+	 */
+	bool repeatFrame(unsigned frame, unsigned delay);
 
-	bool empty() const;
+	unsigned frameCount() const;
 
-	void reserve(const unsigned size);
+	bool empty() const;
 
 
 	/**
-	 * @brief save file to uri
-	 * @param uri the filename
+	 * @brief finish completes the file.
 	 * @return true if successful
 	 */
-	bool save(const std::string& uri);
+	bool finish();
+
+
+	/**
+	 * @brief cancel stops writing and removes the incomplete file.
+	 * @param resume whether the frames spilled to a scratch file are kept,
+	 * for resume() to take them up. They take as much disk space as their
+	 * pixels.
+	 */
+	void cancel(const bool resume = false);
+
+
+	/**
+	 * @brief hash XXH64 of 'size' bytes, to tell frames or settings apart.
+	 * @param seed a previous hash, to chain them.
+	 */
+	static uint64_t hash(const byte* bytes,
+						 const std::size_t size,
+						 const uint64_t seed = 0);
 
 
 private:
@@ -0,0 +1,151 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef ANIMATIONWRITER_HPP
+#define ANIMATIONWRITER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief The AnimationWriter class is the interface of the animation file
+ * writers: open the file, append the frames as they are made and finish it.
+ * Writers of formats that can be streamed write each frame as it arrives,
+ * so the memory used does not grow with the number of frames.
+ * Writers that hold the frames until finish() may spill them to a scratch
+ * file instead, from which an interrupted animation can be resumed.
+ */
+class AnimationWriter {
+public:
+	typedef unsigned char byte;
+	typedef std::unique_ptr<AnimationWriter> Ptr;
+	enum PixelFormat { RGBA, RGB };
+
+	/// a frame written before the animation was resumed
+	struct Stored {
+		unsigned frames; // the number of frames added it stands for
+		bool keep;
+	};
+
+	virtual ~AnimationWriter() {}
+
+
+	/**
+	 * @brief create the writer for the extension of 'uri', a streaming
+	 * one for GIF and a Magick++ one, holding every frame, for the others.
+	 * @param uri the file name.
+	 * @param format the layout of the frames passed to appendFrame.
+	 * @param spill whether frames held until finish() go to a scratch file.
+	 */
+	static Ptr create(const std::string& uri,
+					  const PixelFormat format,
+					  const bool spill = false);
+
+
+	/**
+	 * @brief encoderThreads the threads a writer may encode a frame on, the
+	 * calling one included: a quarter of the hardware threads, as exports
+	 * render the next frames on the others meanwhile.
+	 */
+	static inline unsigned encoderThreads() {
+		return std::max(1u, std::thread::hardware_concurrency() / 4);
+	}
+
+
+	/**
+	 * @brief open starts a new animation, overwriting 'uri'.
+	 * @return true if successful.
+	 */
+	virtual bool open(const std::string& uri) = 0;
+
+
+	/**
+	 * @brief resume takes up the animation of the same 'key' that was left
+	 * unfinished at the uri given to open(), if the writer kept its frames.
+	 * It must be called before the first frame.
+	 * @param key identifies the animation, as made from its settings.
+	 * @param stored receives the frames already written.
+	 * @return true if frames were resumed.
+	 */
+	virtual bool resume(const uint64_t key, std::vector<Stored>& stored) = 0;
+
+
+	/**
+	 * @brief appendFrame adds a frame at the end of the animation.
+	 * All the frames must have the size of the first one.
+	 * @param w the width in pixels
+	 * @param h the height in pixels
+	 * @param bytes the image data
+	 * @param delay the duration of this frame in 1/100 s
+	 * @param keep whether the frame is to be repeated by repeatFrame().
+	 * @return true if the frame was written.
+	 */
+	virtual bool appendFrame(const unsigned w,
+							 const unsigned h,
+							 const byte* bytes,
+							 const unsigned delay,
+							 const bool keep) = 0;
+
+
+	/**
+	 * @brief repeatFrame adds at the end of the animation the same image as
+	 * that of a kept frame, without its pixels. Formats that can not refer
+	 * to a frame still store it again, but from what the writer kept of it.
+	 * @param frame the index of the kept frame, the first frame being 0.
+	 * @param delay the duration of this frame in 1/100 s
+	 * @return true if the frame was written.
+	 */
+	virtual bool repeatFrame(const unsigned frame, const unsigned delay) = 0;
+
+
+	/**
+	 * @brief extendFrame shows the last frame for longer.
+	 * @param delay the duration added to that of the last frame, in 1/100 s
+	 * @return true if the frame was changed, false if there is no frame or
+	 * its duration can not be as long.
+	 */
+	virtual bool extendFrame(const unsigned delay) = 0;
+
+
+	/**
+	 * @brief finish completes and closes the file.
+	 * @return true if the whole animation was written.
+	 */
+	virtual bool finish() = 0;
+
+
+	/**
+	 * @brief cancel closes the file unfinished.
+	 * @param resume whether frames spilled to a scratch file are kept there,
+	 * to be resumed, rather than removed.
+	 */
+	virtual void cancel(const bool resume) = 0;
+};
+
+
+#endif // ANIMATIONWRITER_HPP
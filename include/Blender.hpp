@@ -28,6 +28,7 @@
 #include <QWidget>
 #include <QString>
 #include <functional>
+#include <chrono>
 
 
 class glBlendWidget;
@@ -94,10 +95,13 @@ public slots:
 
 
 private:
+	typedef std::chrono::steady_clock Clock;
+
 	void setupUI(const QString& title);
 
 	void stepAnimation();
-	float t(const unsigned frame_number) const;
+	float nextFrame(float frame_number, AnimDir& dir) const;
+	float t(const float frame_number) const;
 
 	QSlider* slider() const;
 
@@ -114,6 +118,7 @@ private:
 	bool _bidirectional;
 	unsigned _duration;
 	unsigned _fps;
+	Clock::time_point _frame_start; // when the frame shown was due
 };
 
 #endif // BLENDER_HPP
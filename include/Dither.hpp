@@ -0,0 +1,128 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef DITHER_HPP
+#define DITHER_HPP
+
+#include "simd.hpp"
+#include "ImageView.hpp"
+#include "Quantizer.hpp"
+#include <vector>
+
+class ThreadPool;
+
+
+/**
+ * @brief The Dither class maps RGBA8888 images to the palette of a Quantizer
+ * like Quantizer::map does, but spreads the difference between each pixel
+ * and its palette color so that smooth gradients do not turn into bands.
+ * Two methods are available:
+ * - ORDERED adds to each pixel a threshold from an 8x8 Bayer matrix, scaled
+ *   to the spacing of the palette colors. Pixels do not depend on each other
+ *   so rows are mapped in parallel, several pixels at a time with the best
+ *   instruction set available. The pattern is fixed on the image, so the
+ *   parts of an animation that do not move keep the same indices.
+ * - FLOYD_STEINBERG diffuses the error of each pixel to its right and lower
+ *   neighbours. Each row waits for the one above to be far enough ahead,
+ *   so rows are mapped in parallel, as a pipeline.
+ * Both give the same indices with any number of threads or instruction set.
+ */
+class Dither {
+public:
+	typedef unsigned char byte;
+
+	enum Method {
+		NONE, ///< nearest color only, as Quantizer::map
+		ORDERED,
+		FLOYD_STEINBERG
+	};
+
+
+	/**
+	 * @brief Dither
+	 * @param pool the threads mapping rows, none to map them all on the
+	 * calling thread. It must outlive the Dither.
+	 */
+	explicit Dither(const Method method = ORDERED,
+					ThreadPool* const pool = 0,
+					const SimdLevel level = simdLevel());
+
+
+	/**
+	 * @brief map writes the index in the current palette of 'quantizer' of
+	 * each pixel of 'img' to 'indices', row by row.
+	 */
+	void map(const ConstImageView& img,
+			 Quantizer& quantizer,
+			 std::vector<byte>& indices);
+
+
+	inline Method method() const {
+		return _method;
+	}
+
+
+	inline SimdLevel level() const {
+		return _level;
+	}
+
+
+	/**
+	 * @brief The Pattern struct is the threshold added to each channel of
+	 * the pixels, by row and column modulo 8, as unsigned amounts to add
+	 * and to subtract, for saturated byte arithmetic.
+	 */
+	struct Pattern {
+		byte add[8][32];
+		byte sub[8][32];
+	};
+
+
+private:
+	typedef void (*Kernel)(const byte* pixels,
+						   const unsigned n,
+						   const byte* add,
+						   const byte* sub,
+						   const uint16_t* table,
+						   byte* out);
+
+	void ordered(const ConstImageView& img,
+				 Quantizer& quantizer,
+				 byte* const out);
+
+	void floydSteinberg(const ConstImageView& img,
+						Quantizer& quantizer,
+						byte* const out);
+
+
+private:
+	Method _method;
+	ThreadPool* _pool;
+	SimdLevel _level;
+	Kernel _kernel;
+	Pattern _pattern;
+	std::vector<int16_t> _errors; // see floydSteinberg()
+};
+
+
+#endif // DITHER_HPP
@@ -0,0 +1,97 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef EXPORTER_HPP
+#define EXPORTER_HPP
+
+#include "utils.hpp"
+#include "ImageView.hpp"
+#include <functional>
+#include <vector>
+
+
+/**
+ * @brief The Exporter class renders the frames of an animation with the
+ * SoftRenderer, several frames at once, one per thread.
+ * With fewer frames than threads, as a short or single frame export, the
+ * threads left over render the tiles of those frames instead.
+ * Each frame only depends on its blend factor so they are all known up
+ * front. Finished frames are handed back in order on the calling thread,
+ * while the following ones are still being rendered.
+ * The frames go through a RingBuffer of frames() slots, so the memory is
+ * bounded and the threads wait when the callback falls behind.
+ */
+class Exporter {
+public:
+	/**
+	 * @brief OnFrame receives the frames in order.
+	 * The image is only valid during the call.
+	 * @return false to stop the export.
+	 */
+	typedef std::function<bool(unsigned frame, const ConstImageView& img)>
+		OnFrame;
+
+	/**
+	 * @brief Exporter
+	 * @param threads the number of threads rendering, at most as many
+	 * frames at once, 0 for one per hardware thread.
+	 * @param frames the most frames held at once, rendered or being
+	 * rendered, 0 for two per thread.
+	 */
+	explicit Exporter(const unsigned threads = 0, const unsigned frames = 0);
+
+
+	/**
+	 * @brief run renders a frame for each blend factor in 'ts', as
+	 * SoftRenderer::drawBlended over a 'background' cleared image.
+	 * @param ts the blend factor of each frame.
+	 * @param width the width of the frames in pixels.
+	 * @param height the height of the frames in pixels.
+	 * @param callback receives the frames, see OnFrame.
+	 * @return true if every frame was handed to the callback, as when 'ts'
+	 * is empty.
+	 */
+	bool run(const Mesh& src_mesh,
+			 const Mesh& dst_mesh,
+			 const Faces& faces,
+			 const ConstImageView& src_img,
+			 const ConstImageView& dst_img,
+			 const color& background,
+			 const std::vector<float>& ts,
+			 const unsigned width,
+			 const unsigned height,
+			 const OnFrame& callback);
+
+
+	unsigned threads() const;
+
+	unsigned frames() const;
+
+
+private:
+	unsigned _threads;
+	unsigned _frames;
+};
+
+
+#endif // EXPORTER_HPP
@@ -34,8 +34,10 @@
 class FFDWidget;
 class Blender;
 class FileManager;
+class RenderThread;
 
 class QUrl;
+class QSize;
 class QTimer;
 class QLabel;
 class QAction;
@@ -110,6 +112,7 @@ private:
 	void setupTimer();
 	void startTimer();
 	void stopTimer();
+	void syncTimer(); // runs the timer only while the animation plays
 
 	void setupToolbar();
 	void setupMenus();
@@ -129,6 +132,8 @@ private:
 
 	QString animMask() const;
 
+	bool keepFrames(const unsigned frames, const QSize& size);
+
 	void handleUrls(QDropEvent* event, QWidget* sender);
 	void process(const QUrl& url, QWidget* sender);
 	void handleImage(QDropEvent* event, QWidget* sender);
@@ -150,6 +155,7 @@ private:
 	FFDWidget* _dst;
 
 	QTimer* _timer;
+	RenderThread* _renderer;
 
 	QMenu* _file_menu;
 	QMenu* _help_menu;
@@ -49,8 +49,6 @@ public:
 			  const FileManagerPtr& file_mgr);
 
 
-	void update();
-
 	void clear();
 
 
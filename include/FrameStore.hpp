@@ -0,0 +1,167 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef FRAMESTORE_HPP
+#define FRAMESTORE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief The FrameStore class keeps the frames of an animation in a scratch
+ * file rather than in memory, as raw pixels at a fixed stride: a header
+ * then a slot per frame, each a Record followed by the pixels. Slots are
+ * memory mapped only while written or read, and the pages of a frame read
+ * are handed back at once, so the memory used does not grow with the
+ * number of frames.
+ * The frame count in the header is only updated once a frame is complete,
+ * so an export that stops, whatever the reason, can be resumed from there
+ * by opening the file again with the same key. Repeated frames refer to
+ * their source and leave their pixels unwritten, a hole in the file.
+ */
+class FrameStore {
+public:
+	typedef unsigned char byte;
+
+	struct Record {
+		uint32_t delay; // in 1/100 s
+		uint32_t source; // the frame with the pixels, this one if not a repeat
+		uint32_t frames; // the number of frames added it stands for
+		uint32_t keep; // whether it may be repeated
+	};
+
+	/// receives the pixels of a frame, valid during the call only
+	typedef std::function<bool(const byte* pixels)> OnPixels;
+
+	FrameStore();
+
+	~FrameStore();
+
+
+	/**
+	 * @brief open starts storing frames in 'path'.
+	 * @param key identifies what is stored.
+	 * @param pixel the bytes per pixel.
+	 * @param resume whether to keep the frames of a file of the same key
+	 * and pixel size, the file is emptied otherwise.
+	 * @return true if successful.
+	 */
+	bool open(const std::string& path,
+			  const uint64_t key,
+			  const unsigned pixel,
+			  const bool resume);
+
+	bool isOpen() const;
+
+
+	/**
+	 * @brief close stops storing frames, keeping the file to be opened again.
+	 */
+	void close();
+
+
+	/**
+	 * @brief remove closes and deletes the file.
+	 */
+	void remove();
+
+
+	/**
+	 * @brief append stores a frame, of the size of the first one.
+	 * @return true if successful.
+	 */
+	bool append(const unsigned w,
+				const unsigned h,
+				const byte* pixels,
+				const unsigned delay,
+				const bool keep);
+
+
+	/**
+	 * @brief repeat stores a frame showing the pixels of a kept 'frame'.
+	 * @return true if successful.
+	 */
+	bool repeat(const unsigned frame, const unsigned delay);
+
+
+	/**
+	 * @brief extend adds 'delay' to that of the last frame, which then
+	 * stands for one more frame.
+	 * @return true if successful.
+	 */
+	bool extend(const unsigned delay);
+
+
+	/// the number of complete frames
+	unsigned size() const;
+
+	unsigned width() const;
+
+	unsigned height() const;
+
+	const Record& record(const unsigned frame) const;
+
+
+	/**
+	 * @brief read maps the pixels of 'frame', or of its source, and passes
+	 * them to 'callback'. Their pages are released after the call.
+	 * @return the callback result, false if the pixels could not be read.
+	 */
+	bool read(const unsigned frame, const OnPixels& callback) const;
+
+
+private:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t pixel;
+		uint64_t key;
+		uint32_t width;
+		uint32_t height;
+		uint32_t count;
+		uint32_t reserved;
+	};
+
+	bool resume();
+
+	bool writeHeader();
+
+	bool writeRecord(const unsigned frame);
+
+	uint64_t offset(const unsigned frame) const;
+
+	uint64_t stride() const;
+
+
+private:
+	std::string _path;
+	int _fd;
+	Header _header;
+	std::vector<Record> _records;
+};
+
+
+#endif // FRAMESTORE_HPP
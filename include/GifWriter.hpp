@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef GIFWRITER_HPP
+#define GIFWRITER_HPP
+
+#include "AnimationWriter.hpp"
+#include "Dither.hpp"
+#include "FrameStore.hpp"
+#include "LzwEncoder.hpp"
+#include "Quantizer.hpp"
+#include "ThreadPool.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief The GifWriter class streams a looping GIF89a animation to a file.
+ * Each frame is encoded as it is appended, written and flushed, so nothing
+ * but the frame being encoded and the colors shown so far are kept in
+ * memory. A palette is reused by the next frames while it fits them, the
+ * first one is the global color table. Past the first frame, only the
+ * rectangle around the pixels that changed is stored, with the pixels left
+ * as shown made transparent. The indices of frames kept to be repeated go
+ * to a FrameStore next to the file, their palettes stay in memory, so a
+ * repeat is neither quantized nor dithered again.
+ * The encoding is native: the Quantizer finds the palette, the Dither maps
+ * the pixels to it and the LzwEncoder compresses the indices.
+ */
+class GifWriter : public AnimationWriter {
+public:
+	/**
+	 * @brief GifWriter
+	 * @param format the layout of the frames passed to appendFrame.
+	 * @param dither how the frames are mapped to their palette.
+	 */
+	explicit GifWriter(const PixelFormat format,
+					   const Dither::Method dither = Dither::ORDERED);
+
+	~GifWriter();
+
+	bool open(const std::string& uri);
+
+	bool resume(const uint64_t key, std::vector<Stored>& stored);
+
+	bool appendFrame(const unsigned w,
+					 const unsigned h,
+					 const byte* bytes,
+					 const unsigned delay,
+					 const bool keep);
+
+	bool repeatFrame(const unsigned frame, const unsigned delay);
+
+	bool extendFrame(const unsigned delay);
+
+	bool finish();
+
+	void cancel(const bool resume);
+
+
+private:
+	bool writeHeader();
+
+	const byte* toRgba(const byte* bytes);
+
+	void encode(const byte* rgba);
+
+	void crop(const byte* rgba, const Quantizer::Palette& palette);
+
+	bool keepIndices();
+
+	bool writeFrame(const unsigned delay,
+					const Quantizer::Palette& palette,
+					const bool global);
+
+
+private:
+	struct Rect {
+		unsigned x, y, w, h;
+	};
+
+	/// what is needed to write a frame again, but its indices
+	struct Kept {
+		unsigned palette; // in _palettes
+		bool global;
+	};
+
+	PixelFormat _format;
+	std::ofstream _out;
+	unsigned _width, _height;
+	unsigned _frames;
+	Quantizer _quantizer;
+	ThreadPool _pool; // for the Dither, of encoderThreads()
+	Dither _dither;
+	bool _global; // the current palette is the global color table
+	LzwEncoder _lzw;
+	std::vector<byte> _rgba; // RGB frames converted
+	std::vector<byte> _indices;
+	std::vector<uint32_t> _canvas; // the colors shown so far, packed
+	Rect _rect; // the part of the canvas the frame covers
+	std::vector<byte> _changes; // whether each pixel is drawn, see crop()
+	std::vector<byte> _data; // the compressed indices
+	unsigned _delay; // of the last frame
+	std::streampos _delayPos; // where it is written
+	std::string _uri;
+	FrameStore _store; // the indices of the kept frames, in order
+	std::vector<Quantizer::Palette> _palettes; // those of the kept frames
+	bool _palette_kept; // the current palette is _palettes.back()
+	std::vector<Kept> _kept;
+	std::vector<unsigned> _sources; // the kept frame of each frame, if any
+};
+
+
+#endif // GIFWRITER_HPP
@@ -0,0 +1,96 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef IMAGEVIEW_HPP
+#define IMAGEVIEW_HPP
+
+#include <cassert>
+
+
+/**
+ * @brief The BasicImageView struct is a non owning view of a RGBA8888 image.
+ * Rows are stored top to bottom, as in a QImage, and each row starts
+ * 'stride' bytes after the previous one.
+ * A view with no bits is a null image, the equivalent of texture id 0.
+ */
+template<typename Byte>
+struct BasicImageView {
+	typedef Byte byte;
+	static const unsigned CHANNELS = 4;
+
+	BasicImageView():
+		bits(0),
+		width(0),
+		height(0),
+		stride(0)
+	{}
+
+
+	BasicImageView(Byte* const bits,
+				   const unsigned width,
+				   const unsigned height,
+				   const unsigned stride = 0):
+		bits(bits),
+		width(width),
+		height(height),
+		stride(stride != 0? stride : width * CHANNELS)
+	{
+		assert(this->stride >= width * CHANNELS);
+	}
+
+
+	inline bool null() const {
+		return bits == 0 or width == 0 or height == 0;
+	}
+
+
+	inline Byte* row(const unsigned y) const {
+		assert(y < height);
+		return bits + y * stride;
+	}
+
+
+	inline Byte* pixel(const unsigned x, const unsigned y) const {
+		assert(x < width);
+		return row(y) + x * CHANNELS;
+	}
+
+
+	Byte* bits;
+	unsigned width;
+	unsigned height;
+	unsigned stride; // in bytes
+};
+
+
+typedef BasicImageView<unsigned char> ImageView;
+typedef BasicImageView<const unsigned char> ConstImageView;
+
+
+inline ConstImageView constView(const ImageView& img) {
+	return ConstImageView(img.bits, img.width, img.height, img.stride);
+}
+
+
+#endif // IMAGEVIEW_HPP
@@ -0,0 +1,87 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef LATENCYMETER_HPP
+#define LATENCYMETER_HPP
+
+#include <chrono>
+#include <string>
+
+
+/**
+ * @brief The LatencyMeter class measures the time from an input to the
+ * swap of the first frame showing it, what the user waits for. The display
+ * adds its scan out, that no program sees.
+ * It only measures with the environment variable FFD_LATENCY set, and then
+ * reports the mean and worst latency to std::cerr every few hundred frames.
+ * input() and paint() are called under the lock of the painted state,
+ * paint() and shown() from the thread that paints.
+ */
+class LatencyMeter {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+
+	/// @brief LatencyMeter names the reports after 'name'
+	explicit LatencyMeter(const std::string& name);
+
+	void name(const std::string& name);
+
+
+	/// @brief enabled tells whether FFD_LATENCY is set
+	static bool enabled();
+
+
+	/**
+	 * @brief input notes that the state now shows an input received at
+	 * 'time'. Until a paint, the oldest input is kept.
+	 */
+	void input(const Clock::time_point& time);
+
+
+	/// @brief paint takes the input that the paint under way shows
+	void paint();
+
+
+	/// @brief shown ends the measure, once the painted frame is swapped
+	void shown();
+
+
+private:
+	void report();
+
+
+private:
+	std::string _name;
+	Clock::time_point _input; // not painted yet
+	Clock::time_point _painted; // painted, not swapped yet
+	bool _has_input;
+	bool _has_painted;
+	unsigned _samples;
+	Clock::duration _total;
+	Clock::duration _worst;
+};
+
+
+#endif // LATENCYMETER_HPP
@@ -0,0 +1,73 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef LZWENCODER_HPP
+#define LZWENCODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief The LzwEncoder class compresses the palette indices of a GIF image.
+ * The strings seen so far are found in an open addressing hash table keyed
+ * by (prefix code, next index), as in compress, instead of a tree of
+ * 4096 x 256 children. The table is reused from one image to the next.
+ */
+class LzwEncoder {
+public:
+	typedef unsigned char byte;
+	static const unsigned MAX_BITS = 12;
+
+	LzwEncoder();
+
+
+	/**
+	 * @brief encode appends to 'out' the GIF table based image data of
+	 * 'indices': the minimum code size, the codes in sub-blocks of at most
+	 * 255 bytes and the block terminator.
+	 * @param indices the palette index of each pixel.
+	 * @param n the number of pixels.
+	 * @param min_code_size the bits of the palette indices, in [2, 8].
+	 * @param out where the data goes.
+	 */
+	void encode(const byte* indices,
+				const std::size_t n,
+				const unsigned min_code_size,
+				std::vector<byte>& out);
+
+
+private:
+	void reset();
+
+	int find(const uint32_t key) const;
+
+
+private:
+	std::vector<uint32_t> _keys; // EMPTY or (prefix << 8 | index)
+	std::vector<uint16_t> _codes;
+};
+
+
+#endif // LZWENCODER_HPP
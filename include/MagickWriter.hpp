@@ -0,0 +1,75 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MAGICKWRITER_HPP
+#define MAGICKWRITER_HPP
+
+#include "AnimationWriter.hpp"
+#include <memory>
+
+
+/**
+ * @brief The MagickWriter class writes any format known by Magick++.
+ * Magick++ writes an animation at once, so the frames are held until
+ * finish(), prefer a streaming writer when there is one. They are held in
+ * memory or, when spilling, in a FrameStore next to the file, the images
+ * only being made at finish(). Magick then caches their pixels on disk
+ * past a memory limit, as it needs them all at once.
+ */
+class MagickWriter : public AnimationWriter {
+public:
+	MagickWriter(const PixelFormat format, const bool spill);
+
+	~MagickWriter();
+
+	bool open(const std::string& uri);
+
+	bool resume(const uint64_t key, std::vector<Stored>& stored);
+
+	bool appendFrame(const unsigned w,
+					 const unsigned h,
+					 const byte* bytes,
+					 const unsigned delay,
+					 const bool keep);
+
+	bool repeatFrame(const unsigned frame, const unsigned delay);
+
+	bool extendFrame(const unsigned delay);
+
+	bool finish();
+
+	void cancel(const bool resume);
+
+
+private:
+	bool readFrames();
+
+
+private:
+	struct PImpl;
+	typedef std::unique_ptr<PImpl> PImplPtr;
+	PImplPtr _pimpl;
+};
+
+
+#endif // MAGICKWRITER_HPP
@@ -28,18 +28,66 @@
 #include <QSize>
 #include <QImage>
 #include <memory>
+#include <vector>
 
 
 class QGLWidget;
 class QGLFramebufferObject;
+class QGLFramebufferObjectFormat;
 
 
+/**
+ * @brief The QRTTPool class keeps the framebuffers of the QRTTs done with
+ * them, to hand them to the next QRTT of the same size and format rather
+ * than allocating another. A pool belongs to a widget, as its framebuffers
+ * belong to the widget context. Up to 'capacity' of the most recently
+ * used ones are kept.
+ */
+class QRTTPool {
+public:
+	typedef std::unique_ptr<QGLFramebufferObject> FBOPtr;
+
+	explicit QRTTPool(const unsigned capacity = 4);
+
+	~QRTTPool();
+
+
+	/// a framebuffer of 'dim' and 'format', pooled if there is one
+	FBOPtr acquire(const QSize& dim,
+				   const QGLFramebufferObjectFormat& format);
+
+
+	/// keeps 'fbo' for acquire()
+	void recycle(FBOPtr fbo);
+
+
+private:
+	QRTTPool(QRTTPool&) = delete;
+	QRTTPool& operator=(QRTTPool&) = delete;
+
+	unsigned _capacity;
+	std::vector<FBOPtr> _fbos; // the least recently used first
+};
+
+
+/**
+ * @brief The QRTT class renders to an offscreen framebuffer while alive.
+ * The framebuffer is drawn upside down, so that its rows read back top to
+ * bottom, the order of QImage, and land where they belong in a single pass.
+ */
 class QRTT {
 public:
 	typedef unsigned char byte;
 	typedef std::unique_ptr<byte> BytePtr;
 
-	QRTT(QGLWidget* const widget, const QSize& dim);
+	/**
+	 * @brief QRTT
+	 * @param pool where the framebuffer is taken from and given back to,
+	 * if any.
+	 */
+	QRTT(QGLWidget* const widget,
+		 const QSize& dim,
+		 QRTTPool* const pool = nullptr);
 
 	~QRTT();
 
@@ -48,6 +96,8 @@ public:
 	unsigned height() const;
 
 	QSize size() const;
+
+	/// the frame, in Format_RGBA8888
 	QImage image() const;
 
 	void bind();
@@ -57,8 +107,9 @@ private:
 	QRTT(QRTT&) = delete;
 	QRTT& operator=(QRTT&) = delete;
 
-	typedef std::unique_ptr<QGLFramebufferObject> FBOPtr;
+	typedef QRTTPool::FBOPtr FBOPtr;
 	QGLWidget* _widget;
+	QRTTPool* _pool;
 	FBOPtr _fbo;
 };
 
@@ -0,0 +1,195 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef QUANTIZER_HPP
+#define QUANTIZER_HPP
+
+#include "ImageView.hpp"
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * @brief The Quantizer class reduces RGBA8888 images to a palette of at most
+ * 256 colors, for the GIF encoder. Alpha is ignored.
+ * The palette is found with k-means on a histogram of the image colors with
+ * BIN_BITS per channel, filled from a sample of the pixels and seeded with
+ * a median cut. Pixels are then mapped through a table, by bin, to their
+ * nearest palette color, computed the first time a bin is met.
+ * Nearest colors are searched among the palette colors sorted by distance
+ * to a first guess, which prunes most of them.
+ */
+class Quantizer {
+public:
+	typedef unsigned char byte;
+
+	struct Color {
+		byte r, g, b;
+	};
+
+	typedef std::vector<Color> Palette;
+
+	static const unsigned MAX_COLORS = 256;
+	static const unsigned BIN_BITS = 5;
+	static const unsigned BIN_SHIFT = 8 - BIN_BITS;
+
+
+	/**
+	 * @brief Quantizer
+	 * @param colors the palette size, in [2, MAX_COLORS].
+	 */
+	explicit Quantizer(const unsigned colors = MAX_COLORS);
+
+
+	/**
+	 * @brief quantize finds the palette of 'img' and makes it current.
+	 * @return the palette, with at most 'colors' entries.
+	 */
+	const Palette& quantize(const ConstImageView& img);
+
+
+	/**
+	 * @brief update moves the colors of the current palette to fit the
+	 * image last given to error(), for images close to the one the palette
+	 * was found for.
+	 * @return the palette, with as many entries as before.
+	 */
+	const Palette& update();
+
+
+	/**
+	 * @brief palette makes 'palette' the current palette, to map images
+	 * with a palette found before.
+	 */
+	void palette(const Palette& palette);
+
+
+	const Palette& palette() const;
+
+
+	/**
+	 * @brief error measures how well the current palette fits 'img'.
+	 * @return the mean, over a sample of the pixels, of the squared distance
+	 * to the nearest palette color.
+	 */
+	float error(const ConstImageView& img);
+
+
+	/// the error of the palette on the image it was found or updated for
+	float error() const;
+
+
+	/**
+	 * @brief map writes the index in the current palette of each pixel of
+	 * 'img' to 'indices', row by row.
+	 */
+	void map(const ConstImageView& img, std::vector<byte>& indices);
+
+
+	/// the index of the color of the current palette closest to (r, g, b)
+	byte nearest(const int r, const int g, const int b) const;
+
+
+	/**
+	 * @brief index the index in the current palette of the color (r, g, b)
+	 * as map() finds it, the nearest color to the center of its bin.
+	 */
+	inline byte index(const byte r, const byte g, const byte b) {
+		const unsigned bin((r >> BIN_SHIFT) << (2 * BIN_BITS) |
+						   (g >> BIN_SHIFT) << BIN_BITS | (b >> BIN_SHIFT));
+
+		if(_table[bin] == NONE)
+			fillBin(bin, 0);
+
+		return byte(_table[bin]);
+	}
+
+
+	/**
+	 * @brief fill finds the palette index of every bin now rather than when
+	 * first met. After that, until the palette changes, map() and index()
+	 * only read the table and can be called from several threads at once.
+	 */
+	void fill();
+
+
+	/**
+	 * @brief table the palette index of each color bin, read four bytes at
+	 * a time by gathers, so followed by a padding entry. Complete after
+	 * fill() only.
+	 */
+	const uint16_t* table() const;
+
+
+	/// the mean distance from a palette color to the nearest other one
+	float spacing() const;
+
+
+private:
+	enum { NONE = 0xffff }; // table entry not found yet
+
+	/// the colors of a histogram bin
+	struct Bin {
+		uint32_t count;
+		uint32_t r, g, b; // sums
+	};
+
+	/// a non empty bin with its mean color
+	struct Point {
+		float rgb[3];
+		uint32_t count;
+		unsigned cluster;
+	};
+
+	typedef std::vector<Point>::iterator Iterator;
+
+	void histogram(const ConstImageView& img);
+
+	void medianCut();
+
+	void kMeans();
+
+	void sortNeighbours();
+
+	unsigned nearest(const float* const rgb, const unsigned guess) const;
+
+	float measure();
+
+	void fillBin(const unsigned bin, const unsigned guess);
+
+	void resetTable();
+
+
+private:
+	unsigned _colors;
+	Palette _palette;
+	std::vector<Bin> _bins;
+	std::vector<Point> _points;
+	std::vector<uint16_t> _table; // palette index by bin, or NONE
+	std::vector<uint32_t> _neighbours; // see sortNeighbours()
+	float _error;
+	float _spacing;
+};
+
+
+#endif // QUANTIZER_HPP
@@ -0,0 +1,119 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RASTERIZER_HPP
+#define RASTERIZER_HPP
+
+#include "simd.hpp"
+#include <vector>
+
+
+/**
+ * @brief The Rasterizer class converts triangles into the horizontal spans of
+ * pixels whose centers they cover, following the GL conventions: positions
+ * have SUBPIXEL_BITS of fixed point precision, pixels exactly on an edge
+ * belong to the triangle only if that is a top or left edge, and both
+ * windings are drawn as with culling disabled.
+ * The edge functions are evaluated several pixels at a time with the best
+ * instruction set available, with a scalar fallback. All of them produce
+ * exactly the same spans.
+ */
+class Rasterizer {
+public:
+	static const int SUBPIXEL_BITS = 8;
+	static const int SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+
+	/// position in fixed point, see toFixed()
+	struct Point {
+		int x, y;
+	};
+
+	/// pixels [x0, x1) of row y
+	struct Span {
+		Span(const int y, const int x0, const int x1):
+			y(y),
+			x0(x0),
+			x1(x1)
+		{}
+
+		int y, x0, x1;
+	};
+
+	typedef std::vector<Span> Spans;
+
+
+	Rasterizer(const SimdLevel level = simdLevel());
+
+
+	/**
+	 * @brief toFixed converts a position in pixels to fixed point.
+	 */
+	static int toFixed(const float f);
+
+
+	/**
+	 * @brief triangle appends to 'spans' the rows covered by (a, b, c),
+	 * clipped to a width x height target, from top to bottom.
+	 * Coordinates must be within [-16384, 16384] pixels.
+	 * @return the number of spans appended.
+	 */
+	unsigned triangle(const Point& a,
+					  const Point& b,
+					  const Point& c,
+					  const unsigned width,
+					  const unsigned height,
+					  Spans& spans) const;
+
+
+	/**
+	 * @brief triangle same as above clipped to the pixels [x0, x1) x [y0, y1)
+	 * of the target, the spans are the same as the unclipped ones cut to it.
+	 */
+	unsigned triangle(const Point& a,
+					  const Point& b,
+					  const Point& c,
+					  const int x0,
+					  const int y0,
+					  const int x1,
+					  const int y1,
+					  Spans& spans) const;
+
+
+	inline SimdLevel level() const {
+		return _level;
+	}
+
+
+	struct Setup;
+
+
+private:
+	typedef void (*Scan)(const Setup& setup, Spans& spans);
+
+	SimdLevel _level;
+	Scan _scan;
+};
+
+
+#endif // RASTERIZER_HPP
@@ -0,0 +1,117 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef RENDERTHREAD_HPP
+#define RENDERTHREAD_HPP
+
+#include <QSize>
+#include <QThread>
+#include <functional>
+#include <memory>
+
+
+class QGLWidget;
+
+
+/**
+ * @brief The RenderThread class paints QGLWidgets on a thread of its own.
+ * It takes their contexts, so the GUI thread only posts paint and resize
+ * requests, that never wait on the GPU, and reaches a context with call().
+ * Requests for a widget not painted yet are merged into one paint.
+ * Widgets keep the state a paint reads under a lock, the GUI thread edits
+ * it meanwhile.
+ */
+class RenderThread : public QThread {
+	Q_OBJECT
+public:
+	typedef std::function<void()> Task;
+
+	/// what a widget does in the thread, with its context current
+	struct View {
+		std::function<void()> initialize;
+		std::function<void(int width, int height)> resize;
+		std::function<void()> paint; // before the buffers are swapped
+		std::function<void()> swapped; // after, optional
+	};
+
+
+	explicit RenderThread(QObject* const parent = nullptr);
+
+	/// @brief ~RenderThread stops the thread, if stop() was not called
+	~RenderThread();
+
+
+	/**
+	 * @brief add hands the context of 'widget' over to the thread, that
+	 * paints it with 'view' from now on. Only before start().
+	 */
+	void add(QGLWidget* const widget, const View& view);
+
+
+	/// @brief paint schedules a paint of 'widget' and returns
+	void paint(QGLWidget* const widget);
+
+
+	/// @brief resize schedules a resize of 'widget' and the paint after it
+	void resize(QGLWidget* const widget, const QSize& size);
+
+
+	/**
+	 * @brief size the size of 'widget' as its view was last resized to, in
+	 * the thread painting it, where the widget's own size must not be read.
+	 * The widget's size anywhere else.
+	 */
+	static QSize size(const QGLWidget* const widget);
+
+
+	/**
+	 * @brief stop finishes the tasks and paints requested, then gives
+	 * the contexts back to the thread that created this one.
+	 */
+	void stop();
+
+
+	/// @brief owner is the render thread with the context of 'widget', if any
+	static RenderThread* owner(const QGLWidget* const widget);
+
+
+	/**
+	 * @brief call runs 'task' with the context of 'widget' current, in the
+	 * thread that owns that context, and returns once it is done.
+	 */
+	static void call(QGLWidget* const widget, const Task& task);
+
+
+protected:
+	void run();
+
+
+private:
+	struct PImpl;
+	typedef std::unique_ptr<PImpl> PImplPtr;
+	PImplPtr _pimpl;
+};
+
+
+#endif // RENDERTHREAD_HPP
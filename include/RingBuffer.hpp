@@ -0,0 +1,175 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef RINGBUFFER_HPP
+#define RINGBUFFER_HPP
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+
+/**
+ * @brief The RingBuffer class is a bounded, lock free queue of 'capacity'
+ * preallocated slots, used to hand frames from the renderers to the encoder.
+ * Every item has a ticket, 0, 1, 2... and ticket i goes to slot
+ * i % capacity. Each slot has a sequence number telling whether it is free
+ * for ticket i (2 * i) or holds it (2 * i + 1), so writers and the reader
+ * only touch the slot's atomic.
+ * Writers may finish in any order but are read in ticket order. A writer
+ * more than 'capacity' tickets ahead of the reader waits, which caps the
+ * memory used and slows the renderers down to the encoder pace.
+ * Waits spin, then yield, then sleep, there is no lock to block on.
+ */
+template<typename T>
+class RingBuffer {
+public:
+	typedef std::uint64_t Ticket;
+
+	explicit RingBuffer(const unsigned capacity):
+		_capacity(capacity),
+		_slots(new Slot[capacity]),
+		_next(0),
+		_closed(false)
+	{
+		assert(capacity != 0);
+
+		for(unsigned i(0); i != capacity; ++i)
+			_slots[i].sequence.store(vacant(i), std::memory_order_relaxed);
+	}
+
+
+	inline unsigned capacity() const {
+		return _capacity;
+	}
+
+
+	/**
+	 * @brief ticket hands out tickets in order to the writers.
+	 */
+	inline Ticket ticket() {
+		return _next.fetch_add(1, std::memory_order_relaxed);
+	}
+
+
+	/**
+	 * @brief beginWrite waits until the slot for 'ticket' is free.
+	 * @return the slot, to be passed to endWrite, or null if closed.
+	 */
+	T* beginWrite(const Ticket ticket) {
+		Slot& slot(_slots[ticket % _capacity]);
+		return wait(slot, vacant(ticket))? &slot.value : 0;
+	}
+
+
+	/// publishes the slot of 'ticket' to the reader.
+	void endWrite(const Ticket ticket) {
+		_slots[ticket % _capacity].sequence.store(filled(ticket),
+												  std::memory_order_release);
+	}
+
+
+	/**
+	 * @brief beginRead waits until 'ticket' was written.
+	 * @return the slot, to be passed to endRead, or null if closed.
+	 */
+	T* beginRead(const Ticket ticket) {
+		Slot& slot(_slots[ticket % _capacity]);
+		return wait(slot, filled(ticket))? &slot.value : 0;
+	}
+
+
+	/// frees the slot of 'ticket' for ticket + capacity.
+	void endRead(const Ticket ticket) {
+		_slots[ticket % _capacity].sequence.store(vacant(ticket + _capacity),
+												  std::memory_order_release);
+	}
+
+
+	/**
+	 * @brief close wakes every wait, they return null from now on.
+	 */
+	void close() {
+		_closed.store(true, std::memory_order_release);
+	}
+
+
+	bool closed() const {
+		return _closed.load(std::memory_order_acquire);
+	}
+
+
+private:
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	struct Slot {
+		std::atomic<Ticket> sequence;
+		T value;
+	};
+
+
+	static inline Ticket vacant(const Ticket ticket) {
+		return ticket * 2;
+	}
+
+
+	static inline Ticket filled(const Ticket ticket) {
+		return ticket * 2 + 1;
+	}
+
+
+	bool wait(const Slot& slot, const Ticket sequence) const {
+		const std::chrono::microseconds sleep(SLEEP_US);
+
+		for(unsigned i(0);; ++i) {
+			if(slot.sequence.load(std::memory_order_acquire) == sequence)
+				return true;
+
+			if(closed())
+				return false;
+
+			if(i < SPINS)
+				continue;
+			else if(i < SPINS + YIELDS)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(sleep);
+		}
+	}
+
+
+private:
+	enum { SPINS = 64, YIELDS = 64, SLEEP_US = 100 };
+
+	const unsigned _capacity;
+	std::unique_ptr<Slot[]> _slots;
+	std::atomic<Ticket> _next;
+	std::atomic<bool> _closed;
+};
+
+
+#endif // RINGBUFFER_HPP
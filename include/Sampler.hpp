@@ -0,0 +1,135 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include "simd.hpp"
+#include "ImageView.hpp"
+#include <vector>
+#include <memory>
+
+
+/**
+ * @brief The Sampler class does the bilinear texture lookups of the software
+ * renderer on a RGBA8888 image. The coordinates outside the image are
+ * clamped to the edge, as GL_CLAMP_TO_EDGE.
+ * Samples are taken along spans, several pixels at a time with the best
+ * instruction set available, and the filter weights are in fixed point,
+ * so every kernel returns exactly the same colors.
+ * The image can be sampled in place (INTERLEAVED) or copied once to one
+ * plane per channel (PLANAR) which, with gathers, fetches both horizontal
+ * neighbours of a channel in one load. The image must outlive the sampler.
+ */
+class Sampler {
+public:
+	typedef unsigned char byte;
+
+	enum Layout { INTERLEAVED, PLANAR };
+
+	/// texel coordinates are in fixed point with FRACTION_BITS.
+	static const int FRACTION_BITS = 16;
+	static const int ONE = 1 << FRACTION_BITS;
+
+	Sampler();
+
+	Sampler(const ConstImageView& img,
+			const Layout layout = INTERLEAVED,
+			const SimdLevel level = simdLevel());
+
+
+	/**
+	 * @brief toFixed converts a coordinate in texels to fixed point.
+	 * Texel centers are at integer coordinates.
+	 */
+	static int toFixed(const float f);
+
+
+	/**
+	 * @brief span samples 'n' pixels starting at (u, v) and moving
+	 * (du, dv) from one pixel to the next. All in fixed point.
+	 * @param out where to write the n RGBA pixels.
+	 */
+	void span(const int u,
+			  const int v,
+			  const int du,
+			  const int dv,
+			  const unsigned n,
+			  byte* const out) const;
+
+
+	inline bool null() const {
+		return _tex.width == 0;
+	}
+
+
+	inline unsigned width() const {
+		return _tex.width;
+	}
+
+
+	inline unsigned height() const {
+		return _tex.height;
+	}
+
+
+	inline Layout layout() const {
+		return _layout;
+	}
+
+
+	inline SimdLevel level() const {
+		return _level;
+	}
+
+
+	struct Texture {
+		const byte* bits;
+		unsigned stride;
+		unsigned width, height;
+		const byte* planes[4];
+		unsigned plane_stride;
+	};
+
+
+private:
+	typedef void (*Kernel)(const Texture& tex,
+						   int u, int v,
+						   const int du, const int dv,
+						   const unsigned n,
+						   byte* out);
+
+	void split(const ConstImageView& img);
+
+
+private:
+	Layout _layout;
+	SimdLevel _level;
+	Kernel _kernel;
+	Texture _tex;
+	std::shared_ptr<std::vector<byte> > _planes; // shared by copies
+};
+
+
+#endif // SAMPLER_HPP
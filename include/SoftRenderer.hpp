@@ -0,0 +1,144 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SOFTRENDERER_HPP
+#define SOFTRENDERER_HPP
+
+#include "utils.hpp"
+#include "ImageView.hpp"
+#include "Rasterizer.hpp"
+#include "Sampler.hpp"
+#include <vector>
+
+
+class ThreadPool;
+
+/**
+ * @brief The SoftRenderer class is a software implementation of drawBlended.
+ * It needs no GL context, the source and destination images are plain
+ * RGBA8888 buffers and the frame is written to a caller supplied buffer.
+ * The output follows the GL path as close as possible: pixel centers are
+ * sampled, edges follow the top-left fill convention and the textures are
+ * bilinearly filtered and clamped to the edges.
+ * The two GL passes are fused, each covered pixel is written once with the
+ * cross dissolve of src and dst. This only differs from GL where the
+ * interpolated mesh folds over itself.
+ * Like with GL the target is not cleared, use clear() for that.
+ * The faces are binned into TILE_SIZE square tiles that can be rendered in
+ * parallel on a ThreadPool. Every pixel belongs to one tile and is drawn
+ * by the faces in order, so the output does not depend on the thread count.
+ */
+class SoftRenderer {
+public:
+	typedef unsigned char byte;
+	static const unsigned TILE_SIZE = 64;
+
+	SoftRenderer(const SimdLevel level = simdLevel());
+
+
+	/**
+	 * @brief setThreadPool sets the pool the tiles are rendered on.
+	 * @param pool the pool, not owned, or null to render on the caller.
+	 */
+	void setThreadPool(ThreadPool* pool);
+
+
+	/**
+	 * @brief clear fills the whole target with a color.
+	 * @param target the image to clear.
+	 * @param c the color in [0, 1].
+	 */
+	void clear(const ImageView& target, const color& c) const;
+
+
+	/**
+	 * @brief drawBlended same as ::drawBlended but rendering to 'target'.
+	 * Null images are skipped, like texture id 0 in the GL version.
+	 * @param src_mesh the source mesh, also the src texture coordinates.
+	 * @param dst_mesh the destination mesh, also the dst texture coordinates.
+	 * @param faces the triangles indexing both meshes.
+	 * @param src_img the source image.
+	 * @param dst_img the destination image.
+	 * @param t the blend factor in [0, 1].
+	 * @param target the image to render to.
+	 */
+	void drawBlended(const Mesh& src_mesh,
+					 const Mesh& dst_mesh,
+					 const Faces& faces,
+					 const ConstImageView& src_img,
+					 const ConstImageView& dst_img,
+					 const float t,
+					 const ImageView& target);
+
+
+	/**
+	 * @brief drawBlended same as above with samplers built by the caller,
+	 * so they can be reused across frames.
+	 */
+	void drawBlended(const Mesh& src_mesh,
+					 const Mesh& dst_mesh,
+					 const Faces& faces,
+					 const Sampler& src,
+					 const Sampler& dst,
+					 const float t,
+					 const ImageView& target);
+
+
+private:
+	typedef std::vector<Rasterizer::Point> Points;
+	typedef std::vector<unsigned> Bin; // face indices
+
+	/// per worker buffers
+	struct Scratch {
+		Rasterizer::Spans spans;
+		std::vector<byte> src_row; // samples of a span
+		std::vector<byte> dst_row;
+	};
+
+	struct Job;
+
+	void transform(const Mesh& mesh, const ImageView& target);
+
+	void texels(const Mesh& tc, const Sampler& tex, Mesh& out);
+
+	void bin(const Faces& faces, const ImageView& target);
+
+	void renderTile(const Job& job, const unsigned tile, const unsigned worker);
+
+
+private:
+	SimdLevel _level;
+	Rasterizer _rasterizer;
+	ThreadPool* _pool;
+	Mesh _mesh;
+	Points _points; // _mesh in target pixels
+	Mesh _src_texels; // texture coordinates in texels
+	Mesh _dst_texels;
+	std::vector<Bin> _tiles;
+	unsigned _tiles_x;
+	std::vector<Scratch> _scratch;
+};
+
+
+#endif // SOFTRENDERER_HPP
@@ -0,0 +1,71 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <memory>
+#include <functional>
+
+
+/**
+ * @brief The ThreadPool class runs loops over independent items on a fixed
+ * set of threads. Each thread starts with a contiguous slice of the items
+ * and once it runs out it steals half of what is left of another slice,
+ * so uneven items still keep every thread busy.
+ * The calling thread works too, a pool of size 1 starts no thread at all.
+ */
+class ThreadPool {
+public:
+	/// the item index and the worker, in [0, size()), running it
+	typedef std::function<void(unsigned index, unsigned worker)> Body;
+
+	/**
+	 * @brief ThreadPool
+	 * @param size the number of threads working, including the caller.
+	 * 0 for one per hardware thread.
+	 */
+	explicit ThreadPool(const unsigned size = 0);
+
+	~ThreadPool();
+
+
+	/**
+	 * @brief parallelFor calls body(i, worker) for every i in [0, count)
+	 * and returns once they all did. Calls happen in no particular order,
+	 * but a worker runs one at a time, so per worker data needs no lock.
+	 * Not reentrant, body must not call parallelFor on the same pool.
+	 */
+	void parallelFor(const unsigned count, const Body& body);
+
+
+	unsigned size() const;
+
+
+private:
+	struct PImpl;
+	typedef std::unique_ptr<PImpl> PImplPtr;
+	PImplPtr _pimpl;
+};
+
+#endif // THREADPOOL_HPP
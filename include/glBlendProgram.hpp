@@ -0,0 +1,100 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GLBLENDPROGRAM_HPP
+#define GLBLENDPROGRAM_HPP
+
+#include "utils.hpp"
+
+#include <QGLBuffer>
+#include <QGLShaderProgram>
+
+
+class QGLContext;
+
+
+/**
+ * @brief The glBlendProgram class draws the blend of two meshes with the
+ * programmable pipeline. Both meshes are kept in vertex buffers and the faces
+ * in an index buffer, the vertex shader interpolates them by the blend factor,
+ * so a frame only updates a uniform. Both images are sampled in one pass.
+ */
+class glBlendProgram {
+public:
+	enum Source {SRC, DST, SOURCES};
+
+
+	glBlendProgram();
+
+	~glBlendProgram();
+
+
+	/**
+	 * @brief init compiles the program in the current 'context'.
+	 * @return false if it lacks shaders or buffers, use drawBlended().
+	 */
+	bool init(const QGLContext* const context);
+
+
+	/**
+	 * @brief mesh uploads 'msh' as the vertices of 'source', unless its
+	 * 'revision' is the one uploaded last. Only the vertices that differ
+	 * from the last upload are written, while dragging a single one.
+	 */
+	void mesh(const Source source, const Mesh& msh, const unsigned revision);
+
+
+	/// @brief faces uploads 'fcs', unless 'revision' is the one uploaded last
+	void faces(const Faces& fcs, const unsigned revision);
+
+
+	/// @brief background replaces a missing src image, the clear color
+	void background(const color& bg);
+
+
+	/// @brief draw is drawBlended() with the uploaded meshes and faces
+	void draw(const int src_tex, const int dst_tex, const float t);
+
+
+private:
+	static const unsigned NONE = ~0u; // revision of nothing uploaded
+
+	QGLShaderProgram _program;
+	QGLBuffer _vertices[SOURCES];
+	Mesh _uploaded[SOURCES]; // what _vertices hold
+	QGLBuffer _indices;
+	unsigned _revisions[SOURCES];
+	unsigned _faces_revision;
+	unsigned _vertex_count[SOURCES];
+	unsigned _index_count;
+	unsigned _index_span; // the vertices the faces use
+	int _attributes[SOURCES];
+	int _t;
+	int _has_src;
+	int _weight;
+	PFNGLACTIVETEXTUREPROC _active_texture; // not in the GL 1.1 headers
+};
+
+
+#endif // GLBLENDPROGRAM_HPP
@@ -26,16 +26,19 @@
 #define GLBLENDWIDGET_HPP
 
 #include "utils.hpp"
-#include "QRTT.hpp"
+#include "glBlendProgram.hpp"
 
 #include <QSize>
 #include <QPoint>
 #include <QImage>
 #include <QGLWidget>
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 
 class glFFDWidget;
+class RenderThread;
 
 
 class glBlendWidget : public QGLWidget {
@@ -70,15 +73,13 @@ public:
 
 	QSize minImgDim();
 
-	QSize fboDim();
+	QImage frame();
 
-	void beginAnimation(const QSize& size);
+	const Faces& faces() const;
 
-	void refresh();
 
-	QImage frame();
-
-	void endAnimation();
+	/// @brief renderIn paints the widget in 'thread' from now on
+	void renderIn(RenderThread* const thread);
 
 
 signals:
@@ -88,8 +89,14 @@ signals:
 public slots:
 	void blendFactor(float t);
 
+	/// @brief invalidate schedules one paintGL() for any number of changes
+	void invalidate();
+
 
 protected:
+	void paintEvent(QPaintEvent* event);
+	void resizeEvent(QResizeEvent* event);
+
 	void paintGL();
 
 	void initializeGL();
@@ -100,10 +107,11 @@ protected:
 
 	cgl::uvec2 dimensions(GLint tex);
 
-	const Faces& faces() const;
-
 	bool invariant() const;
 
+	/// @brief follow repaints on the changes of 'w' instead of 'old'
+	void follow(glFFDWidget* const old, glFFDWidget* const w);
+
 	void dragEvent();
 
 
@@ -112,16 +120,28 @@ private:
 
 	QSize imgDim(const Extreme ext);
 
+	/**
+	 * @brief source reads the mesh of 'w' under its lock, into the program
+	 * or, without one, into 'copy'.
+	 * @return the texture of 'w'.
+	 */
+	GLuint source(const glBlendProgram::Source s,
+				  const glFFDWidget* const w,
+				  Mesh& copy);
+
 
 private:
-	typedef std::unique_ptr<QRTT> QRTTPtr;
+	typedef std::unique_ptr<glBlendProgram> ProgramPtr;
 
 	float _t;
 	glFFDWidget* _src;
 	glFFDWidget* _dst;
 	Faces _faces;
+	unsigned _faces_revision;
+	ProgramPtr _program; // null without shaders
+	std::atomic<bool> _dirty; // repaint scheduled
+	std::mutex _state_lock; // _t and _faces, never held while waiting
 	QPoint _mouse_press_pos;
-	QRTTPtr _rtt;
 
 };
 
@@ -27,13 +27,22 @@
 
 
 #include "vec.hpp"
+#include "QRTT.hpp"
+#include "LatencyMeter.hpp"
 
 #include <QPoint>
+#include <QTimer>
 #include <QString>
+#include <QGLBuffer>
 #include <QGLWidget>
 
 #include <vector>
 #include <iosfwd>
+#include <atomic>
+#include <mutex>
+
+
+class RenderThread;
 
 
 class glFFDWidget : public QGLWidget {
@@ -80,6 +89,11 @@ public:
 		return _resolution;
 	}
 
+	/// @brief meshRevision changes with every change of the mesh
+	inline unsigned meshRevision() const {
+		return _mesh_revision;
+	}
+
 
 	vec2 normalize(const int x, const int y);
 
@@ -129,9 +143,24 @@ public:
 	QImage frame();
 
 
+	/// @brief renderIn paints the widget in 'thread' from now on
+	void renderIn(RenderThread* const thread);
+
+	/// @brief stateLock is held while the state paintGL() reads changes
+	inline std::recursive_mutex& stateLock() const {
+		return _state_lock;
+	}
+
+	/// the texture in RGBA8888, top row first
+	QImage image();
+
+
 signals:
 	void selectionChanged(int new_selection);
 
+	/// @brief changed is emitted when the mesh or the texture changes
+	void changed();
+
 	void resolutionChanged(int new_resolution);
 
 	void destructiveChange();
@@ -149,8 +178,12 @@ protected:
 	void paintGL();
 	void resizeGL(int width, int height);
 
+	void paintEvent(QPaintEvent* event);
+	void resizeEvent(QResizeEvent* event);
+
 	void mousePressEvent(QMouseEvent* event);
 	void mouseMoveEvent(QMouseEvent* event);
+	void mouseReleaseEvent(QMouseEvent* event);
 
 	void dragEnterEvent(QDragEnterEvent* event);
 	void dropEvent(QDropEvent* event);
@@ -160,11 +193,32 @@ protected:
 	void dragEvent();
 
 
+private slots:
+	/// @brief applyDrag moves the selection to the last position dragged to
+	void applyDrag();
+
+
 private:
-	void draw() const;
+	/// @brief paint draws the texture, and the mesh if 'with_mesh' is set
+	void paint(const bool with_mesh);
+
+	void draw();
 	void drawTex() const;
-	void drawMesh() const;
-	void drawSelection() const;
+	void drawMesh();
+	void drawSelection();
+
+	/// @brief meshChanged marks the vertices in [first, last) to upload
+	void meshChanged(const unsigned first, const unsigned last);
+
+	/// @brief invalidate schedules one paintGL() for any number of changes
+	void invalidate();
+
+	/// @brief uploadMesh sends the vertices and indices changed to the GPU
+	void uploadMesh();
+
+	/// @brief bindMesh binds the buffers of the mesh, if there are any
+	bool bindMesh();
+	void releaseMesh();
 
 	inline const Indices& indices() const {
 		return _indices;
@@ -186,9 +240,24 @@ private:
 	bool _modified;
 	unsigned _resolution;
 	Mesh _mesh;
+	unsigned _mesh_revision;
 	Indices _indices;
+	QGLBuffer _mesh_buffer;
+	QGLBuffer _indices_buffer;
+	int _mesh_bytes; // allocated, QGLBuffer::size() needs the buffer bound
+	unsigned _dirty_first; // vertices not uploaded yet, in [first, last)
+	unsigned _dirty_last;
+	bool _dirty_indices;
+	std::atomic<bool> _dirty; // repaint scheduled
+	mutable std::recursive_mutex _state_lock; // never held while waiting
 	QPoint _mouse;
+	QTimer _drag_timer; // runs for a display refresh after a move
+	QPoint _drag_to;
+	LatencyMeter::Clock::time_point _drag_since; // first move not applied
+	bool _drag_pending;
+	LatencyMeter _latency;
 	QString _uri;
+	QRTTPool _rtt_pool; // for frame()
 };
 
 
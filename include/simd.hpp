@@ -0,0 +1,84 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+
+/**
+ * @file simd.hpp
+ * Runtime detection of the vector instruction sets the software renderer
+ * can use. Each kernel is compiled for every set the compiler knows about
+ * and the best one supported by the running cpu is picked at runtime,
+ * so the same binary runs on any machine.
+ */
+
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define SIMD_X86 1
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_X86 0
+#define SIMD_TARGET(isa)
+#endif
+
+// Inlines every call into the kernel, so generic helpers end up compiled
+// with the instruction set of the kernel.
+#if defined(__GNUC__)
+#define SIMD_FLATTEN __attribute__((flatten))
+#else
+#define SIMD_FLATTEN
+#endif
+
+#if defined(__ARM_NEON) and defined(__aarch64__)
+#define SIMD_NEON 1
+#else
+#define SIMD_NEON 0
+#endif
+
+
+enum SimdLevel {
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_NEON_LEVEL
+};
+
+
+/**
+ * @brief simdLevel the best instruction set available on this cpu.
+ * The environment variable FFD_SIMD can lower it ("scalar", "sse2",
+ * "avx2", "neon"), which is useful to compare the kernels output.
+ * @return the detected level, computed once.
+ */
+SimdLevel simdLevel();
+
+
+/**
+ * @brief simdName a printable name of a level.
+ */
+const char* simdName(const SimdLevel level);
+
+
+#endif // SIMD_HPP
@@ -60,9 +60,6 @@ void interpolate(const Mesh& a,
 				 Mesh& msh);
 
 
-bool glBlendAlphaEquals(const float& a);
-
-
 void draw(const int tex,
 		  const Mesh& mesh,
 		  const Mesh& tc,
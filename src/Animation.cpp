@@ -24,98 +24,312 @@
 
 #include "Animation.hpp"
 
-#include <Magick++.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <vector>
-#include <iostream>
-
-
-const char* const FORMATS[] = { "RGBA", "RGB" };
 
 
 struct Animation::PImpl {
-	typedef Magick::Image Image;
-	typedef std::vector<Image> Frames;
-	Frames _frames;
+	AnimationWriter::Ptr writer;
 	Animation::PixelFormat format;
+	std::string uri;
+	std::string partial_uri; // written until finished
+	unsigned frames;
+	bool spill;
+	std::vector<unsigned> written; // the written frame of each frame
+	std::vector<uint64_t> hashes; // of each written frame
+	std::vector<bool> kept; // whether each written frame can be repeated
 };
 
 
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+std::string partialUri(const std::string& uri);
+
+inline uint64_t rotl(const uint64_t x, const unsigned r);
+
+
+/* *****************************************************************************
+ * Animation implementation.
+ * ****************************************************************************/
+
+
 Animation::Animation(OnFrameAdded callback, PixelFormat format)
 	: _pimpl(new PImpl)
 	, _frameCallback(callback)
 {
-	static bool once(false);
+	_pimpl->format = format;
+	_pimpl->frames = 0;
+	_pimpl->spill = false;
+}
 
-	if(not once) {
-		Magick::InitializeMagick(0);
-		once = true;
+
+Animation::~Animation() {
+	if(_pimpl->writer != nullptr)
+		cancel();
+}
+
+
+bool Animation::open(const std::string& uri) {
+	if(_pimpl->writer != nullptr)
+		cancel();
+
+	_pimpl->frames = 0;
+	_pimpl->written.clear();
+	_pimpl->hashes.clear();
+	_pimpl->kept.clear();
+
+	if(uri.empty())
+		return false;
+
+	_pimpl->uri = uri;
+	_pimpl->partial_uri = partialUri(uri);
+	_pimpl->writer = AnimationWriter::create(uri, _pimpl->format,
+											 _pimpl->spill);
+
+	if(not _pimpl->writer->open(_pimpl->partial_uri)) {
+		_pimpl->writer.reset();
+		return false;
 	}
 
-	_pimpl->format = format;
+	return true;
 }
 
 
-Animation::~Animation() {}
+void Animation::spill(const bool state) {
+	_pimpl->spill = state;
+}
+
+
+bool Animation::spill() const {
+	return _pimpl->spill;
+}
+
 
+/**
+ * The pixels of the resumed frames are not read back, so they are given
+ * hashes of their own, that no frame added later is expected to match.
+ */
+unsigned Animation::resume(const uint64_t key) {
+	std::vector<AnimationWriter::Stored> stored;
+
+	if(_pimpl->writer == nullptr or _pimpl->frames != 0 or
+	   not _pimpl->writer->resume(key, stored))
+		return 0;
+
+	for(unsigned i(0); i != stored.size(); ++i) {
+		_pimpl->hashes.push_back(hash(reinterpret_cast<const byte*>(&i),
+									  sizeof(i), key));
+		_pimpl->kept.push_back(stored[i].keep);
+		_pimpl->written.insert(_pimpl->written.end(), stored[i].frames, i);
+		_pimpl->frames += stored[i].frames;
+	}
+
+	if(_frameCallback != nullptr)
+		_frameCallback(_pimpl->frames);
 
+	return _pimpl->frames;
+}
+
+
+/**
+ * A frame the same as the last one written, unless that one can not be
+ * repeated and this one has to, extends the last one.
+ */
 bool Animation::addFrame(const unsigned w,
 						 const unsigned h,
 						 const byte* const bytes,
-						 const unsigned delay)
+						 const unsigned delay,
+						 const bool keep)
 {
-	typedef Magick::Image Image;
-	try {
-		const char* const fmt(FORMATS[_pimpl->format]);
-		_pimpl->_frames.push_back(Image(w, h, fmt, Magick::CharPixel, bytes));
-		_pimpl->_frames.back().animationDelay(delay);
-	} catch(const Magick::Exception& e) {
-		std::cerr << "Animation::addFrame: Magick++ exception: "
-				  << e.what() << std::endl;
+	if(_pimpl->writer == nullptr)
+		return false;
+
+	const unsigned pixel(_pimpl->format == AnimationWriter::RGB? 3 : 4);
+	const uint64_t h64(hash(bytes, std::size_t(w) * h * pixel,
+							uint64_t(w) << 32 | h));
+
+	if(_pimpl->hashes.empty() or _pimpl->hashes.back() != h64 or
+	   (keep and not _pimpl->kept.back()) or
+	   not _pimpl->writer->extendFrame(delay)) {
+		if(not _pimpl->writer->appendFrame(w, h, bytes, delay, keep))
+			return false;
+
+		_pimpl->hashes.push_back(h64);
+		_pimpl->kept.push_back(keep);
+	}
+
+	_pimpl->written.push_back(_pimpl->hashes.size() - 1);
+	++_pimpl->frames;
+
+	if(_frameCallback != nullptr)
+		return _frameCallback(_pimpl->frames);
+
+	return true;
+}
+
+
+/**
+ * A frame the same as the last one written extends it. That one may not be
+ * kept, so the frame refers to the kept one it repeats, as will its repeats.
+ */
+bool Animation::repeatFrame(const unsigned frame, const unsigned delay) {
+	if(_pimpl->writer == nullptr or frame >= _pimpl->frames)
 		return false;
+
+	const unsigned source(_pimpl->written[frame]);
+
+	if(_pimpl->hashes[source] != _pimpl->hashes.back() or
+	   not _pimpl->writer->extendFrame(delay)) {
+		if(not _pimpl->writer->repeatFrame(source, delay))
+			return false;
+
+		_pimpl->hashes.push_back(_pimpl->hashes[source]);
+		_pimpl->kept.push_back(true);
 	}
 
+	_pimpl->written.push_back(source);
+	++_pimpl->frames;
+
 	if(_frameCallback != nullptr)
-		return _frameCallback(_pimpl->_frames.size());
+		return _frameCallback(_pimpl->frames);
 
 	return true;
 }
 
 
 bool Animation::empty() const {
-	return _pimpl->_frames.empty();
+	return _pimpl->frames == 0;
 }
 
 
-unsigned Animation::frameCount() {
-	return _pimpl->_frames.size();
+unsigned Animation::frameCount() const {
+	return _pimpl->frames;
 }
 
 
-void Animation::clear() {
-	return _pimpl->_frames.clear();
+/**
+ * The animation is written next to 'uri' and only replaces it once complete,
+ * so a canceled or failed export leaves an existing file as it was.
+ */
+bool Animation::finish() {
+	if(_pimpl->writer == nullptr)
+		return false;
+
+	bool saved(_pimpl->writer->finish());
+	_pimpl->writer.reset();
+
+	if(saved) {
+		std::remove(_pimpl->uri.c_str());
+		saved = std::rename(_pimpl->partial_uri.c_str(),
+							_pimpl->uri.c_str()) == 0;
+	}
+
+	if(not saved)
+		std::remove(_pimpl->partial_uri.c_str());
+
+	return saved;
 }
 
 
-void Animation::reserve(const unsigned size) {
-	_pimpl->_frames.reserve(size);
+void Animation::cancel(const bool resume) {
+	if(_pimpl->writer == nullptr)
+		return;
+
+	_pimpl->writer->cancel(resume);
+	_pimpl->writer.reset();
+	std::remove(_pimpl->partial_uri.c_str());
 }
 
 
-bool Animation::save(const std::string& uri) {
-	if(empty() or uri.empty())
-		return false;
+/**
+ * Four lanes of 8 bytes are consumed at once, then the tail, then the
+ * result is mixed so that every bit of the input affects all of its bits.
+ * Fast enough to be negligible next to encoding.
+ */
+uint64_t Animation::hash(const byte* bytes,
+						 const std::size_t size,
+						 const uint64_t seed)
+{
+	const uint64_t P1(11400714785074694791ULL);
+	const uint64_t P2(14029467366897019727ULL);
+	const uint64_t P3(1609587929392839161ULL);
+	const uint64_t P4(9650029242287828579ULL);
+	const uint64_t P5(2870177450012600261ULL);
 
-	try {
-		Magick::writeImages(_pimpl->_frames.begin(),
-							_pimpl->_frames.end(),
-							uri);
-	} catch(const Magick::Exception& e) {
-		std::cerr << "Animation::save: Magick++ exception: "
-				  << e.what() << std::endl;
-		return false;
+	const auto read64 = [](const byte* const p) {
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	};
+	const auto round = [P1, P2](const uint64_t acc, const uint64_t in) {
+		return rotl(acc + in * P2, 31) * P1;
+	};
+
+	const byte* const end(bytes + size);
+	uint64_t h;
+
+	if(size >= 32) {
+		uint64_t v[] = {seed + P1 + P2, seed + P2, seed, seed - P1};
+
+		for(; bytes + 32 <= end; bytes += 32)
+			for(unsigned i(0); i != 4; ++i)
+				v[i] = round(v[i], read64(bytes + i * 8));
+
+		h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+
+		for(unsigned i(0); i != 4; ++i)
+			h = (h ^ round(0, v[i])) * P1 + P4;
 	}
+	else
+		h = seed + P5;
 
-	return true;
+	h += size;
+
+	for(; bytes + 8 <= end; bytes += 8)
+		h = rotl(h ^ round(0, read64(bytes)), 27) * P1 + P4;
+
+	if(bytes + 4 <= end) {
+		uint32_t v;
+		std::memcpy(&v, bytes, sizeof(v));
+		h = rotl(h ^ (v * P1), 23) * P2 + P3;
+		bytes += 4;
+	}
+
+	for(; bytes != end; ++bytes)
+		h = rotl(h ^ (*bytes * P5), 11) * P1;
+
+	h ^= h >> 33;
+	h *= P2;
+	h ^= h >> 29;
+	h *= P3;
+	h ^= h >> 32;
+	return h;
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/**
+ * @brief partialUri inserts ".part" before the extension of 'uri', that
+ * is kept as the writers may pick the format from it.
+ */
+std::string partialUri(const std::string& uri) {
+	const std::string::size_type dot(uri.find_last_of('.'));
+	const std::string::size_type slash(uri.find_last_of("/\\"));
+
+	if(dot == std::string::npos or
+	   (slash != std::string::npos and dot < slash))
+		return uri + ".part";
+
+	return uri.substr(0, dot) + ".part" + uri.substr(dot);
 }
 
 
+/// rotates left
+inline uint64_t rotl(const uint64_t x, const unsigned r) {
+	return (x << r) | (x >> (64 - r));
+}
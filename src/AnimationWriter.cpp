@@ -0,0 +1,47 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "AnimationWriter.hpp"
+#include "GifWriter.hpp"
+#include "MagickWriter.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+
+const std::string GIF_EXTENSION("gif");
+
+
+AnimationWriter::Ptr AnimationWriter::create(const std::string& uri,
+											 const PixelFormat format,
+											 const bool spill)
+{
+	const std::string::size_type dot(uri.find_last_of('.'));
+	std::string ext(dot == std::string::npos? "" : uri.substr(dot + 1));
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+	if(ext == GIF_EXTENSION)
+		return Ptr(new GifWriter(format));
+
+	return Ptr(new MagickWriter(format, spill));
+}
@@ -22,18 +22,22 @@
  * THE SOFTWARE.
  */
 
-#include "QRTT.hpp"
 #include "Blender.hpp"
 #include "Animation.hpp"
+#include "Exporter.hpp"
 #include "SaveHelper.hpp"
 #include "glBlendWidget.hpp"
+#include "glFFDWidget.hpp"
 #include "SignalBlocker.hpp"
 
 #include <QGridLayout>
 #include <QSlider>
 #include <QLabel>
 
+#include <algorithm>
 #include <cassert>
+#include <thread>
+#include <vector>
 
 
 const float DEFAULT_BLEND_FACTOR(0.5f);
@@ -42,6 +46,21 @@ const unsigned MAX_FPS(10); // Magick++ max fps (?)
 const bool DEFAULT_ANIMATION_STATE(false);
 const Blender::AnimDir DEFAULT_ANIMATION_DIRECTION(Blender::FRONT);
 const bool DEFAULT_DIRECTIONAL_STATE(true);
+const color BACKGROUND(1.0f, 1.0f, 1.0f, 1.0f); // as glBlendWidget clears
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+template<typename T>
+uint64_t hash(const std::vector<T>& items, const uint64_t seed);
+
+uint64_t hash(const QImage& img, const uint64_t seed);
+
+
+/* *****************************************************************************
+ * Blender implementation.
+ * ****************************************************************************/
 
 
 Blender::Blender(QWidget* const parent, const QString& title):
@@ -53,7 +72,8 @@ Blender::Blender(QWidget* const parent, const QString& title):
 	_animated(DEFAULT_ANIMATION_STATE),
 	_bidirectional(DEFAULT_DIRECTIONAL_STATE),
 	_duration(DEFAULT_LENGTH),
-	_fps(MAX_FPS)
+	_fps(MAX_FPS),
+	_frame_start(Clock::now())
 {
 	setupUI(title);
 	clear();
@@ -100,32 +120,56 @@ void Blender::setupUI(const QString& title) {
 
 void Blender::update() {
 	if(animated())
-		stepAnimation();
-
-	widget()->updateGL();
+		stepAnimation(); // repaints if the blend factor changed
 }
 
 
 void Blender::stepAnimation() {
-	const float num_frames(unidirectionalNumberOfFrames());
+	if(fps() == 0)
+		return;
+
+	// show the frame due now, however late or early the timer ticked
+	const Clock::time_point now(Clock::now());
+	const Clock::duration second(std::chrono::seconds(1));
+	const Clock::duration period(second / fps());
+	const Clock::rep due((now - _frame_start) / period);
+
+	if(due <= 0)
+		return;
+
+	_frame_start += due * period;
+
+	// frames past a whole loop come back to the same one
+	const unsigned n(unidirectionalNumberOfFrames());
+	const unsigned loop(bidirectional() ? 2 * (n - 1) : n);
 	float frame_number(frameNumber());
 
+	for(Clock::rep i(due % std::max(loop, 1u)); i != 0; --i)
+		frame_number = nextFrame(frame_number, _anim_dir);
+
+	frameNumber(frame_number);
+}
+
+
+float Blender::nextFrame(float frame_number, AnimDir& dir) const {
+	const float num_frames(unidirectionalNumberOfFrames());
+
 	assert(0.0f <= frame_number and frame_number < num_frames);
 
-	frame_number += animationDirection();
+	frame_number += dir;
 
 	if(frame_number >= num_frames) {
 		if(bidirectional()) {
 			frame_number = std::max(0.0f, num_frames - 2.0f);
-			_anim_dir = BACK;
+			dir = BACK;
 		} else
 			frame_number = 0.0f;
 	} else if(frame_number < 0.0f) {
 		frame_number = 1.0f;
-		_anim_dir = FRONT;
+		dir = FRONT;
 	}
 
-	frameNumber(frame_number);
+	return frame_number;
 }
 
 
@@ -142,6 +186,7 @@ void Blender::bidirectional(const bool state) {
 void Blender::animated(const bool state) {
 	if(_animated != state) {
 		_animated = state;
+		_frame_start = Clock::now(); // the paused time is not played
 		emit animStateChanged();
 	}
 }
@@ -154,16 +199,17 @@ void Blender::duration(int n) {
 
 
 void Blender::fps(int f) {
-	if(f >= 0)
+	if(f >= 0 and unsigned(f) != _fps) {
 		_fps = f;
+		_frame_start = Clock::now();
+	}
 }
 
 
 void Blender::frameNumber(const float n) {
 	const unsigned number_of_frames(unidirectionalNumberOfFrames());
 	assert(n < number_of_frames);
-	const float t(n / (number_of_frames - 1));
-	widget()->blendFactor(t);
+	widget()->blendFactor(t(n));
 }
 
 
@@ -194,6 +240,14 @@ void Blender::blendFactorChanged(float t) {
 }
 
 
+/**
+ * The blend factors of the frames are found by stepping the animation up
+ * front, then the frames are rendered on several threads by the Exporter.
+ * A bidirectional animation shows its frames again on its way back, so each
+ * blend factor is rendered once and its later frames repeat the first one.
+ * The frames are identified by all they are made of, so that an export of
+ * the same frames left unfinished is resumed rather than started again.
+ */
 void Blender::generate(Animation& animation) {
 	unsigned number_of_frames(totalNumberOfFrames());
 	assert(number_of_frames != 0);
@@ -201,20 +255,104 @@ void Blender::generate(Animation& animation) {
 	const SaveHelper sh(this, number_of_frames);
 	const unsigned delay(sh.delay());
 
-	widget()->beginAnimation(widget()->maxImgDim());
+	std::vector<float> ts; // the distinct blend factors, in order of use
+	std::vector<unsigned> renders; // the index in 'ts' of each frame
+	std::vector<unsigned> uses; // the number of frames of each blend factor
+	renders.reserve(number_of_frames);
+	float frame_number(frameNumber());
 
 	for(unsigned i(0); i != number_of_frames; ++i) {
-		widget()->refresh();
+		const float factor(t(frame_number));
+		const unsigned render(std::find(ts.begin(), ts.end(), factor) -
+							  ts.begin());
+
+		if(render == ts.size()) {
+			ts.push_back(factor);
+			uses.push_back(0);
+		}
+
+		renders.push_back(render);
+		++uses[render];
+		frame_number = nextFrame(frame_number, _anim_dir);
+	}
 
-		const QImage& img(widget()->frame());
+	const QImage& src_img(widget()->src()->image());
+	const QImage& dst_img(widget()->dst()->image());
+	const QSize& size(widget()->maxImgDim());
+
+	if(size.isEmpty())
+		return;
+
+	const Mesh& src_mesh(widget()->src()->mesh());
+	const Mesh& dst_mesh(widget()->dst()->mesh());
+	const Faces& faces(widget()->faces());
+	const unsigned settings[] = {delay, unsigned(size.width()),
+								 unsigned(size.height())};
+	uint64_t key(Animation::hash(
+					 reinterpret_cast<const Animation::byte*>(settings),
+					 sizeof(settings)));
+	key = hash(ts, hash(renders, key));
+	key = hash(src_mesh, hash(dst_mesh, hash(faces, key)));
+	key = hash(src_img, hash(dst_img, key));
+
+	std::vector<unsigned> first_frames(ts.size()); // of each render
+
+	for(unsigned i(number_of_frames); i-- != 0;)
+		first_frames[renders[i]] = i;
+
+	const unsigned done(animation.resume(key));
+	assert(done <= number_of_frames);
+
+	// renders come in order of first use, those before 'skipped' are done
+	const unsigned skipped(done == 0? 0 :
+						   *std::max_element(renders.begin(),
+											 renders.begin() + done) + 1);
+	unsigned next(done);
+
+	// adds the frames that repeat the renders before 'rendered'
+	const auto repeat = [&](const unsigned rendered) {
+		for(; next != renders.size() and renders[next] < rendered; ++next)
+			if(not animation.repeatFrame(first_frames[renders[next]], delay))
+				return false;
+
+		return true;
+	};
+
+	// a resumed export may have rendered everything, then only repeats
+	if(repeat(skipped) and skipped != ts.size()) {
+		// the writer encodes on its share of the threads, see encoderThreads
+		const unsigned threads(std::thread::hardware_concurrency());
+		const unsigned encoder(AnimationWriter::encoderThreads());
+		Exporter exporter(threads > encoder? threads - encoder : 1);
+		exporter.run(src_mesh, dst_mesh, faces,
+					 ConstImageView(src_img.constBits(), src_img.width(),
+									src_img.height(), src_img.bytesPerLine()),
+					 ConstImageView(dst_img.constBits(), dst_img.width(),
+									dst_img.height(), dst_img.bytesPerLine()),
+					 BACKGROUND,
+					 std::vector<float>(ts.begin() + skipped, ts.end()),
+					 size.width(), size.height(),
+					 [&](const unsigned i, const ConstImageView& img) {
+						 const unsigned render(skipped + i);
+						 assert(first_frames[render] == next);
+
+						 if(not animation.addFrame(img.width, img.height,
+												   img.bits, delay,
+												   uses[render] > 1))
+							 return false;
+
+						 ++next;
+						 return repeat(render + 1);
+					 });
+	}
 
-		if(not animation.addFrame(img.width(), img.height(), img.bits(), delay))
-			return;
+	frameNumber(frame_number);
+}
 
-		stepAnimation();
-	}
 
-	widget()->endAnimation();
+float Blender::t(const float frame_number) const {
+	const unsigned number_of_frames(unidirectionalNumberOfFrames());
+	return frame_number / (number_of_frames - 1);
 }
 
 
@@ -269,3 +407,22 @@ bool Blender::animated() const {
 QSlider* Blender::slider() const {
 	return _slider;
 }
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// the hash of the bytes of 'items', chained to 'seed'
+template<typename T>
+uint64_t hash(const std::vector<T>& items, const uint64_t seed) {
+	return items.empty()? seed :
+		Animation::hash(reinterpret_cast<const Animation::byte*>(&items[0]),
+						items.size() * sizeof(T), seed);
+}
+
+
+/// the hash of the pixels of 'img', chained to 'seed'
+uint64_t hash(const QImage& img, const uint64_t seed) {
+	return Animation::hash(img.constBits(), img.bytesPerLine() * img.height(),
+						   seed);
+}
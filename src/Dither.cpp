@@ -0,0 +1,437 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "Dither.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+
+typedef Dither::byte byte;
+typedef Dither::Pattern Pattern;
+
+const unsigned BIN_BITS(Quantizer::BIN_BITS);
+const unsigned BIN_SHIFT(Quantizer::BIN_SHIFT);
+const unsigned BIN_MASK((1 << BIN_BITS) - 1);
+const unsigned CHANNELS(4);
+const float MAX_SPREAD(64.0f); // of the ordered thresholds
+const unsigned CHUNK(64); // pixels of a row between two progress updates
+
+/// thresholds in [0, 64), as far as possible from their neighbours
+const byte BAYER[8][8] = {
+	{ 0, 32,  8, 40,  2, 34, 10, 42},
+	{48, 16, 56, 24, 50, 18, 58, 26},
+	{12, 44,  4, 36, 14, 46,  6, 38},
+	{60, 28, 52, 20, 62, 30, 54, 22},
+	{ 3, 35, 11, 43,  1, 33,  9, 41},
+	{51, 19, 59, 27, 49, 17, 57, 25},
+	{15, 47,  7, 39, 13, 45,  5, 37},
+	{63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void makePattern(const float spread, Pattern& pattern);
+
+inline byte orderedPixel(const byte* const pixel,
+						 const byte* const add,
+						 const byte* const sub,
+						 const uint16_t* const table);
+
+void orderedScalar(const byte* pixels,
+				   const unsigned n,
+				   const byte* add,
+				   const byte* sub,
+				   const uint16_t* table,
+				   byte* out);
+
+#if SIMD_X86
+void orderedSSE2(const byte* pixels,
+				 const unsigned n,
+				 const byte* add,
+				 const byte* sub,
+				 const uint16_t* table,
+				 byte* out);
+
+void orderedAVX2(const byte* pixels,
+				 const unsigned n,
+				 const byte* add,
+				 const byte* sub,
+				 const uint16_t* table,
+				 byte* out);
+#endif
+
+inline int clamp(const int value);
+
+inline void waitFor(const std::atomic<unsigned>& progress,
+					const unsigned value);
+
+
+/* *****************************************************************************
+ * Dither implementation.
+ * ****************************************************************************/
+Dither::Dither(const Method method,
+			   ThreadPool* const pool,
+			   const SimdLevel level):
+	_method(method),
+	_pool(pool),
+	_level(SIMD_SCALAR),
+	_kernel(&orderedScalar)
+{
+	std::memset(&_pattern, 0, sizeof(_pattern));
+
+#if SIMD_X86
+	if(level == SIMD_AVX2 or level == SIMD_SSE2) {
+		_level = level;
+		_kernel = level == SIMD_AVX2? &orderedAVX2 : &orderedSSE2;
+	}
+#else
+	(void)level;
+#endif
+}
+
+
+void Dither::map(const ConstImageView& img,
+				 Quantizer& quantizer,
+				 std::vector<byte>& indices)
+{
+	assert(not quantizer.palette().empty());
+
+	if(_method == NONE) {
+		quantizer.map(img, indices);
+		return;
+	}
+
+	indices.resize(img.width * img.height);
+
+	if(indices.empty())
+		return;
+
+	quantizer.fill();
+
+	if(_method == ORDERED)
+		ordered(img, quantizer, &indices.front());
+	else
+		floydSteinberg(img, quantizer, &indices.front());
+}
+
+
+/**
+ * The thresholds span the spacing of the palette colors: less leaves bands,
+ * more only adds noise.
+ */
+void Dither::ordered(const ConstImageView& img,
+					 Quantizer& quantizer,
+					 byte* const out)
+{
+	makePattern(std::min(quantizer.spacing(), MAX_SPREAD), _pattern);
+
+	const uint16_t* const table(quantizer.table());
+	const auto row = [&](const unsigned y, const unsigned) {
+		_kernel(img.row(y), img.width, _pattern.add[y % 8],
+				_pattern.sub[y % 8], table, out + y * img.width);
+	};
+
+	if(_pool != 0)
+		_pool->parallelFor(img.height, row);
+	else
+		for(unsigned y(0); y != img.height; ++y)
+			row(y, 0);
+}
+
+
+/**
+ * Each thread takes the next row not taken yet and maps its pixels CHUNK by
+ * CHUNK, once the row above has moved past the last of them, since a pixel
+ * gets the error of the three pixels above it. Rows thus finish in order,
+ * and no more than one per thread are being mapped at once: the errors for
+ * the next rows only need that many rows, plus two, reused in turn.
+ * Each row has a pixel of margin on both sides so the edges need no test.
+ */
+void Dither::floydSteinberg(const ConstImageView& img,
+							Quantizer& quantizer,
+							byte* const out)
+{
+	const Quantizer::Palette& palette(quantizer.palette());
+	const unsigned w(img.width), h(img.height);
+	const unsigned threads(_pool != 0? _pool->size() : 1);
+	const unsigned rows(threads + 2);
+	const unsigned stride((w + 2) * 3);
+	_errors.assign(rows * stride, 0);
+
+	std::unique_ptr<std::atomic<unsigned>[]> done(
+		new std::atomic<unsigned>[h]);
+	std::atomic<unsigned> next(0);
+
+	for(unsigned y(0); y != h; ++y)
+		done[y].store(0, std::memory_order_relaxed);
+
+	const auto run = [&](const unsigned, const unsigned) {
+		for(unsigned y(next++); y < h; y = next++) {
+			const byte* const pixels(img.row(y));
+			int16_t* const errors(&_errors[y % rows * stride] + 3);
+			int16_t* const below(&_errors[(y + 1) % rows * stride] + 3);
+			std::fill(below - 3, below - 3 + stride, 0);
+			int right[3] = {0, 0, 0}; // the error for the next pixel
+
+			for(unsigned begin(0); begin < w; begin += CHUNK) {
+				const unsigned end(std::min(begin + CHUNK, w));
+
+				if(y != 0)
+					waitFor(done[y - 1], std::min(end + 1, w));
+
+				for(unsigned x(begin); x != end; ++x) {
+					const byte* const p(pixels + x * CHANNELS);
+					int16_t* const e(errors + x * 3);
+					int16_t* const b(below + x * 3);
+					int16_t* const b_left(b - 3);
+					int16_t* const b_right(b + 3);
+					const int r(clamp(p[0] + e[0] + right[0]));
+					const int g(clamp(p[1] + e[1] + right[1]));
+					const int bl(clamp(p[2] + e[2] + right[2]));
+					const byte index(quantizer.index(r, g, bl));
+					const Quantizer::Color& c(palette[index]);
+					const int error[3] = {r - c.r, g - c.g, bl - c.b};
+					out[y * w + x] = index;
+
+					for(unsigned i(0); i != 3; ++i) {
+						const int seven(error[i] * 7 / 16);
+						const int three(error[i] * 3 / 16);
+						const int five(error[i] * 5 / 16);
+						right[i] = seven;
+						b_left[i] += three;
+						b[i] += five;
+						b_right[i] += error[i] - seven - three - five;
+					}
+				}
+
+				done[y].store(end, std::memory_order_release);
+			}
+		}
+	};
+
+	if(_pool != 0)
+		_pool->parallelFor(threads, run);
+	else
+		run(0, 0);
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// the thresholds centered on 0, for every channel but alpha
+void makePattern(const float spread, Pattern& pattern) {
+	std::memset(&pattern, 0, sizeof(pattern));
+
+	for(unsigned y(0); y != 8; ++y)
+		for(unsigned x(0); x != 8; ++x) {
+			const float t((BAYER[y][x] + 0.5f) / 64.0f - 0.5f);
+			const int offset(int(std::floor(t * spread + 0.5f)));
+
+			for(unsigned c(0); c != 3; ++c) {
+				pattern.add[y][x * CHANNELS + c] = byte(std::max(offset, 0));
+				pattern.sub[y][x * CHANNELS + c] = byte(std::max(-offset, 0));
+			}
+		}
+}
+
+
+/// 'add' and 'sub' the thresholds of the pixel, saturated as the kernels do
+inline byte orderedPixel(const byte* const pixel,
+						 const byte* const add,
+						 const byte* const sub,
+						 const uint16_t* const table)
+{
+	unsigned bin(0);
+
+	for(unsigned c(0); c != 3; ++c) {
+		const int value(std::max(std::min(pixel[c] + add[c], 255) - sub[c],
+								 0));
+		bin = bin << BIN_BITS | value >> BIN_SHIFT;
+	}
+
+	return byte(table[bin]);
+}
+
+
+void orderedScalar(const byte* pixels,
+				   const unsigned n,
+				   const byte* add,
+				   const byte* sub,
+				   const uint16_t* table,
+				   byte* out)
+{
+	for(unsigned x(0); x != n; ++x) {
+		const unsigned i(x % 8 * CHANNELS);
+		out[x] = orderedPixel(pixels + x * CHANNELS, add + i, sub + i, table);
+	}
+}
+
+
+#if SIMD_X86
+/* *****************************************************************************
+ * x86 kernels.
+ * ****************************************************************************/
+/**
+ * @brief bins4 adds the thresholds to 4 RGBA pixels and returns the bin of
+ * each one, in its 32 bit lane.
+ */
+SIMD_TARGET("sse2")
+inline __m128i bins4(__m128i pixels, const __m128i add, const __m128i sub) {
+	const __m128i mask(_mm_set1_epi32(BIN_MASK));
+	pixels = _mm_subs_epu8(_mm_adds_epu8(pixels, add), sub);
+
+	const __m128i r(_mm_and_si128(_mm_srli_epi32(pixels, BIN_SHIFT), mask));
+	const __m128i g(_mm_and_si128(_mm_srli_epi32(pixels, 8 + BIN_SHIFT),
+								  mask));
+	const __m128i b(_mm_and_si128(_mm_srli_epi32(pixels, 16 + BIN_SHIFT),
+								  mask));
+
+	return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 2 * BIN_BITS),
+									 _mm_slli_epi32(g, BIN_BITS)), b);
+}
+
+
+/// same as bins4 for 8 pixels.
+SIMD_TARGET("avx2")
+inline __m256i bins8(__m256i pixels, const __m256i add, const __m256i sub) {
+	const __m256i mask(_mm256_set1_epi32(BIN_MASK));
+	pixels = _mm256_subs_epu8(_mm256_adds_epu8(pixels, add), sub);
+
+	const __m256i r(_mm256_and_si256(_mm256_srli_epi32(pixels, BIN_SHIFT),
+									 mask));
+	const __m256i g(_mm256_and_si256(_mm256_srli_epi32(pixels,
+													   8 + BIN_SHIFT), mask));
+	const __m256i b(_mm256_and_si256(_mm256_srli_epi32(pixels,
+													   16 + BIN_SHIFT), mask));
+
+	return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 2 * BIN_BITS),
+										   _mm256_slli_epi32(g, BIN_BITS)),
+						   b);
+}
+
+
+/**
+ * The bins are computed 4 pixels at a time, the table has no gather so the
+ * lookups stay scalar.
+ */
+SIMD_TARGET("sse2") SIMD_FLATTEN
+void orderedSSE2(const byte* pixels,
+				 const unsigned n,
+				 const byte* add,
+				 const byte* sub,
+				 const uint16_t* table,
+				 byte* out)
+{
+	const unsigned N(4);
+	alignas(16) uint32_t bins[N];
+	unsigned x(0);
+
+	for(; x + N <= n; x += N) {
+		const unsigned i(x % 8 * CHANNELS);
+		_mm_store_si128(reinterpret_cast<__m128i*>(bins), bins4(
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels +
+															 x * CHANNELS)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(add + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(sub + i))));
+
+		for(unsigned j(0); j != N; ++j)
+			out[x + j] = byte(table[bins[j]]);
+	}
+
+	for(; x != n; ++x) {
+		const unsigned i(x % 8 * CHANNELS);
+		out[x] = orderedPixel(pixels + x * CHANNELS, add + i, sub + i, table);
+	}
+}
+
+
+/**
+ * The table entries are gathered 8 at a time, as 32 bit values whose upper
+ * half is the next entry, hence the padding entry of the table.
+ */
+SIMD_TARGET("avx2") SIMD_FLATTEN
+void orderedAVX2(const byte* pixels,
+				 const unsigned n,
+				 const byte* add,
+				 const byte* sub,
+				 const uint16_t* table,
+				 byte* out)
+{
+	const unsigned N(8);
+	const int* const entries(reinterpret_cast<const int*>(table));
+	const __m256i adds(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+											  add)));
+	const __m256i subs(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+											  sub)));
+	// the low byte of each 32 bit lane to the first 4 bytes of each half
+	const __m256i low_bytes(_mm256_setr_epi8(
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+	unsigned x(0);
+
+	for(; x + N <= n; x += N) {
+		const __m256i bins(bins8(_mm256_loadu_si256(
+									 reinterpret_cast<const __m256i*>(
+										 pixels + x * CHANNELS)),
+								 adds, subs));
+		const __m256i indices(_mm256_shuffle_epi8(
+			_mm256_i32gather_epi32(entries, bins, 2), low_bytes));
+		const int lo(_mm_cvtsi128_si32(_mm256_castsi256_si128(indices)));
+		const int hi(_mm_cvtsi128_si32(_mm256_extracti128_si256(indices, 1)));
+		std::memcpy(out + x, &lo, 4);
+		std::memcpy(out + x + 4, &hi, 4);
+	}
+
+	for(; x != n; ++x) {
+		const unsigned i(x % 8 * CHANNELS);
+		out[x] = orderedPixel(pixels + x * CHANNELS, add + i, sub + i, table);
+	}
+}
+#endif
+
+
+inline int clamp(const int value) {
+	return std::max(0, std::min(value, 255));
+}
+
+
+/// until 'progress' reaches 'value', rows are short so it is never long
+inline void waitFor(const std::atomic<unsigned>& progress,
+					const unsigned value)
+{
+	while(progress.load(std::memory_order_acquire) < value)
+		std::this_thread::yield();
+}
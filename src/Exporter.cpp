@@ -0,0 +1,199 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "Exporter.hpp"
+#include "Sampler.hpp"
+#include "RingBuffer.hpp"
+#include "SoftRenderer.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+
+typedef unsigned char byte;
+typedef std::vector<byte> Buffer;
+typedef RingBuffer<Buffer> Frames;
+
+// frames rendered ahead per thread, while the callback is busy
+const unsigned FRAMES_PER_THREAD(2);
+
+
+/**
+ * @brief The Job struct is the input shared, read only, by every thread.
+ */
+struct Job {
+	Job(const Mesh& src_mesh,
+		const Mesh& dst_mesh,
+		const Faces& faces,
+		const ConstImageView& src_img,
+		const ConstImageView& dst_img,
+		const color& background,
+		const std::vector<float>& ts,
+		const unsigned width,
+		const unsigned height):
+		src_mesh(src_mesh),
+		dst_mesh(dst_mesh),
+		faces(faces),
+		src(src_img),
+		dst(dst_img),
+		background(background),
+		ts(ts),
+		width(width),
+		height(height)
+	{}
+
+	const Mesh& src_mesh;
+	const Mesh& dst_mesh;
+	const Faces& faces;
+	const Sampler src;
+	const Sampler dst;
+	const color& background;
+	const std::vector<float>& ts;
+	const unsigned width;
+	const unsigned height;
+};
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void renderFrames(const Job& job, Frames& frames, const unsigned tiles);
+
+
+/* *****************************************************************************
+ * Exporter implementation.
+ * ****************************************************************************/
+Exporter::Exporter(const unsigned threads, const unsigned frames):
+	_threads(threads != 0? threads :
+			 std::max(1u, std::thread::hardware_concurrency())),
+	_frames(frames != 0? frames : _threads * FRAMES_PER_THREAD)
+{}
+
+
+bool Exporter::run(const Mesh& src_mesh,
+				   const Mesh& dst_mesh,
+				   const Faces& faces,
+				   const ConstImageView& src_img,
+				   const ConstImageView& dst_img,
+				   const color& background,
+				   const std::vector<float>& ts,
+				   const unsigned width,
+				   const unsigned height,
+				   const OnFrame& callback)
+{
+	assert(width != 0 and height != 0);
+
+	const unsigned count(ts.size());
+
+	if(count == 0)
+		return true;
+
+	const unsigned threads(std::min(_threads, count));
+	const Job job(src_mesh, dst_mesh, faces, src_img, dst_img, background,
+				  ts, width, height);
+	Frames frames(std::min(_frames, count));
+	std::vector<std::thread> workers;
+
+	// the threads are shared out among the frames rendered at once
+	for(unsigned i(0); i != threads; ++i)
+		workers.push_back(std::thread(&renderFrames, std::cref(job),
+									  std::ref(frames),
+									  _threads / threads +
+									  (i < _threads % threads)));
+
+	unsigned frame(0);
+
+	for(; frame != count; ++frame) {
+		const Buffer* const buffer(frames.beginRead(frame));
+		assert(buffer != 0);
+
+		const ConstImageView img(&buffer->front(), width, height);
+
+		if(not callback(frame, img)) {
+			frames.close();
+			break;
+		}
+
+		frames.endRead(frame);
+	}
+
+	for(unsigned i(0); i != workers.size(); ++i)
+		workers[i].join();
+
+	return frame == count;
+}
+
+
+unsigned Exporter::threads() const {
+	return _threads;
+}
+
+
+unsigned Exporter::frames() const {
+	return _frames;
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/**
+ * @brief renderFrames is the loop of each thread, it takes the next frame
+ * not yet taken until there are none left. The buffers are allocated on
+ * first use and reused for the following frames of their slot.
+ * @param tiles the threads rendering the tiles of a frame, this one included.
+ */
+void renderFrames(const Job& job, Frames& frames, const unsigned tiles) {
+	const unsigned count(job.ts.size());
+	const unsigned size(job.width * job.height * ImageView::CHANNELS);
+	SoftRenderer renderer;
+	std::unique_ptr<ThreadPool> pool;
+
+	if(tiles > 1) {
+		pool.reset(new ThreadPool(tiles));
+		renderer.setThreadPool(pool.get());
+	}
+
+	for(;;) {
+		const Frames::Ticket frame(frames.ticket());
+
+		if(frame >= count)
+			return;
+
+		Buffer* const buffer(frames.beginWrite(frame));
+
+		if(buffer == 0)
+			return;
+
+		buffer->resize(size);
+
+		const ImageView target(&buffer->front(), job.width, job.height);
+		renderer.clear(target, job.background);
+		renderer.drawBlended(job.src_mesh, job.dst_mesh, job.faces,
+							 job.src, job.dst, job.ts[frame], target);
+
+		frames.endWrite(frame);
+	}
+}
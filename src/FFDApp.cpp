@@ -30,6 +30,7 @@
 #include "FileManager.hpp"
 #include "glBlendWidget.hpp"
 #include "SignalBlocker.hpp"
+#include "RenderThread.hpp"
 
 #include <QDir>
 #include <QUrl>
@@ -105,6 +106,9 @@ const unsigned MSG_DELAY(10000);
 
 const unsigned DEFAULT_IMG_SIZE_PX(400);
 
+// frames held past this are spilled to a scratch file, see Animation::spill
+const quint64 MAX_HELD_BYTES(quint64(1) << 30);
+
 const QString PRJ_EXT("xml");
 const QString GIF_EXT("gif");
 const QString MPG_EXT("mpg");
@@ -184,6 +188,7 @@ FFDApp::FFDApp():
 	_src(0),
 	_dst(0),
 	_timer(0),
+	_renderer(0),
 	_file_menu(0),
 	_help_menu(0),
 	_about(0),
@@ -219,12 +224,13 @@ FFDApp::FFDApp():
 
 	clear();
 
-	fps(DEFAULT_FPS); // start the frame update timer.
+	fps(DEFAULT_FPS);
 }
 
 
 FFDApp::~FFDApp() {
 	clear();
+	_renderer->stop(); // the contexts go back before the widgets go
 }
 
 
@@ -261,6 +267,12 @@ void FFDApp::initDataUI() {
 
 	_mix->widget()->src(src_wgt);
 	_mix->widget()->dst(dst_wgt);
+
+	_renderer = new RenderThread(this);
+	src_wgt->renderIn(_renderer);
+	dst_wgt->renderIn(_renderer);
+	bw->renderIn(_renderer);
+	_renderer->start();
 }
 
 
@@ -395,6 +407,7 @@ void FFDApp::setupMenus() {
 
 void FFDApp::setupTimer() {
 	_timer = new QTimer(this);
+	_timer->setTimerType(Qt::PreciseTimer); // Blender paces by the clock
 	connect(_timer, SIGNAL(timeout()), this, SLOT(update()));
 }
 
@@ -406,11 +419,7 @@ void FFDApp::fps(int n) {
 	assert(unsigned(n) <= MAX_FPS);
 
 	_mix->fps(n);
-
-	if(n == 0)
-		stopTimer();
-	else
-		startTimer();
+	syncTimer();
 
 	if(_fps_sb->value() != int(_mix->fps())) {
 		const SignalBlocker block(_fps_sb);
@@ -538,19 +547,19 @@ void FFDApp::toggleAnimation() {
 void FFDApp::playAnimation() {
 	_mix->animated(true);
 	_play->setIcon(_pause_icon);
+	syncTimer();
 }
 
 
 void FFDApp::pauseAnimation() {
 	_mix->animated(false);
 	_play->setIcon(_play_icon);
+	syncTimer();
 }
 
 
 void FFDApp::update() {
-	_src->update();
-	_mix->update();
-	_dst->update();
+	_mix->update(); // the views repaint themselves when they change
 }
 
 
@@ -712,22 +721,52 @@ bool FFDApp::saveAnimation(const QString& uri) {
 		progress.setValue(frame);
 		return not progress.wasCanceled();
 	});
-	animation.reserve(number_of_frames);
 
-	_mix->generate(animation);
-	progress.hide();
+	const QSize& size(_mix->widget()->maxImgDim());
+	animation.spill(quint64(size.width()) * size.height() * 4 *
+					number_of_frames > MAX_HELD_BYTES);
 
-	bool canceled(animation.frameCount() != number_of_frames);
 	bool saved(false);
 
-	if(not canceled and (saved = animation.save(uri.toStdString())))
-		_anim_uri = uri;
+	if(animation.open(uri.toStdString())) {
+		_mix->generate(animation);
+
+		if(animation.frameCount() != number_of_frames)
+			animation.cancel(progress.wasCanceled() and animation.spill() and
+							 keepFrames(animation.frameCount(), size));
+		else if((saved = animation.finish()))
+			_anim_uri = uri;
+	}
+
+	progress.hide();
 
-	startTimer();
+	syncTimer();
 	return saved;
 }
 
 
+/**
+ * The frames spilled by a canceled export let the same export resume where
+ * it stopped, but take about as much disk space as their pixels.
+ */
+bool FFDApp::keepFrames(const unsigned frames, const QSize& size) {
+	if(frames == 0)
+		return false;
+
+	const quint64 megabytes((quint64(size.width()) * size.height() * 4 *
+							 frames) >> 20);
+	QMessageBox question(this);
+	question.setText("The animation was canceled.");
+	question.setInformativeText("Keep the " + QString::number(frames) +
+								" frames made so far, up to " +
+								QString::number(megabytes) +
+								" MB on disk, to resume it next time?");
+	question.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
+	question.setDefaultButton(QMessageBox::No);
+	return question.exec() == QMessageBox::Yes;
+}
+
+
 QString FFDApp::animMask() const {
 	const QString& mask("*." + GIF_EXT + " *." + MPG_EXT);
 	return mask;
@@ -979,6 +1018,14 @@ void FFDApp::stopTimer() {
 }
 
 
+void FFDApp::syncTimer() {
+	if(_mix->animated() and _mix->fps() != 0)
+		startTimer();
+	else
+		stopTimer();
+}
+
+
 Blender* FFDApp::mix() const {
 	return _mix;
 }
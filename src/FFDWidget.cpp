@@ -52,6 +52,7 @@ FFDWidget::FFDWidget(QWidget* const parent,
 
 void FFDWidget::setupUI(const QString& title, QGLWidget *const shared_widget) {
 	_widget = new glFFDWidget(this, shared_widget);
+	_widget->setObjectName(title); // names its latency reports
 
 	_title = new QLabel(title);
 	_title->setAlignment(Qt::AlignCenter);
@@ -100,11 +101,6 @@ void FFDWidget::filesChanged() {
 }
 
 
-void FFDWidget::update() {
-	widget()->updateGL();
-}
-
-
 void FFDWidget::clear() {
 	widget()->clear();
 	files()->clear();
@@ -23,8 +23,10 @@
  */
 
 #include "FileManager.hpp"
+#include "RenderThread.hpp"
 
 #include <QPixmap>
+#include <QImage>
 #include <QGLWidget>
 #include <QFileInfo>
 
@@ -49,10 +51,12 @@ FileManager::~FileManager() {
 
 
 void FileManager::clear() {
-	const Iterator end(_resources.end());
+	RenderThread::call(ctx(), [this]() {
+		const Iterator end(_resources.end());
 
-	for(Iterator i(_resources.begin()); i != end; ++i)
-		ctx()->deleteTexture(i->glid);
+		for(Iterator i(_resources.begin()); i != end; ++i)
+			ctx()->deleteTexture(i->glid);
+	});
 
 	_resources.clear();
 }
@@ -68,13 +72,18 @@ bool FileManager::add(const QPixmap& img, const QString& uri) {
 	if(exists(uri))
 		return true;
 
-	if(ctx()->context() != QGLContext::currentContext())
-		ctx()->makeCurrent();
-
 	if(img.isNull())
 		return false;
 
-	add(Resource(uri, ctx()->bindTexture(img)));
+	// pixmaps only live on the GUI thread, the render thread gets an image
+	const QImage image(img.toImage());
+
+	unsigned glid(0);
+	RenderThread::call(ctx(), [this, &image, &glid]() {
+		glid = ctx()->bindTexture(image);
+	});
+
+	add(Resource(uri, glid));
 
 	return true;
 }
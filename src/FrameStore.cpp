@@ -0,0 +1,313 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "FrameStore.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+typedef FrameStore::byte byte;
+
+const char MAGIC[8] = {'F', 'F', 'D', 'F', 'R', 'A', 'M', 'E'};
+const uint32_t VERSION(1);
+const uint64_t ALIGNMENT(1 << 16); // of the slots, a multiple of any page
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void release(const int fd, const uint64_t offset, const uint64_t length);
+
+
+/* *****************************************************************************
+ * FrameStore implementation.
+ * ****************************************************************************/
+FrameStore::FrameStore():
+	_fd(-1)
+{
+	std::memset(&_header, 0, sizeof(_header));
+}
+
+
+FrameStore::~FrameStore() {
+	close();
+}
+
+
+bool FrameStore::open(const std::string& path,
+					  const uint64_t key,
+					  const unsigned pixel,
+					  const bool resume)
+{
+	close();
+	_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+	if(_fd < 0)
+		return false;
+
+	_path = path;
+
+	if(resume and this->resume() and _header.key == key and
+	   _header.pixel == pixel)
+		return true;
+
+	std::memset(&_header, 0, sizeof(_header));
+	std::memcpy(_header.magic, MAGIC, sizeof(MAGIC));
+	_header.version = VERSION;
+	_header.pixel = pixel;
+	_header.key = key;
+	_records.clear();
+
+	if(::ftruncate(_fd, ALIGNMENT) != 0 or not writeHeader()) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+
+bool FrameStore::isOpen() const {
+	return _fd >= 0;
+}
+
+
+void FrameStore::close() {
+	if(_fd >= 0)
+		::close(_fd);
+
+	_fd = -1;
+	_records.clear();
+}
+
+
+void FrameStore::remove() {
+	const bool opened(isOpen());
+	close();
+
+	if(opened)
+		std::remove(_path.c_str());
+}
+
+
+/**
+ * The slot is mapped just long enough to copy the record and the pixels,
+ * then only is the frame counted in the header.
+ */
+bool FrameStore::append(const unsigned w,
+						const unsigned h,
+						const byte* const pixels,
+						const unsigned delay,
+						const bool keep)
+{
+	if(not isOpen())
+		return false;
+
+	if(_records.empty()) {
+		_header.width = w;
+		_header.height = h;
+	}
+	else if(w != _header.width or h != _header.height)
+		return false;
+
+	const unsigned frame(_records.size());
+	const Record record = {delay, frame, 1, keep};
+	const uint64_t size(sizeof(Record) + uint64_t(w) * h * _header.pixel);
+
+	if(::ftruncate(_fd, offset(frame + 1)) != 0)
+		return false;
+
+	void* const slot(::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+							_fd, offset(frame)));
+
+	if(slot == MAP_FAILED)
+		return false;
+
+	std::memcpy(slot, &record, sizeof(Record));
+	std::memcpy(static_cast<byte*>(slot) + sizeof(Record), pixels,
+				size - sizeof(Record));
+
+	// dirty pages are not dropped from the page cache, written back first
+	const bool synced(::msync(slot, size, MS_SYNC) == 0);
+	::munmap(slot, size);
+
+	if(not synced)
+		return false;
+
+	release(_fd, offset(frame), size);
+
+	_records.push_back(record);
+	return writeHeader();
+}
+
+
+bool FrameStore::repeat(const unsigned frame, const unsigned delay) {
+	if(not isOpen() or frame >= _records.size() or not _records[frame].keep)
+		return false;
+
+	const unsigned last(_records.size());
+	const Record record = {delay, _records[frame].source, 1, true};
+	_records.push_back(record);
+
+	if(::ftruncate(_fd, offset(last + 1)) != 0 or not writeRecord(last)) {
+		_records.pop_back();
+		return false;
+	}
+
+	return writeHeader();
+}
+
+
+bool FrameStore::extend(const unsigned delay) {
+	if(not isOpen() or _records.empty())
+		return false;
+
+	Record& record(_records.back());
+	record.delay += delay;
+	++record.frames;
+	return writeRecord(_records.size() - 1);
+}
+
+
+unsigned FrameStore::size() const {
+	return _records.size();
+}
+
+
+unsigned FrameStore::width() const {
+	return _header.width;
+}
+
+
+unsigned FrameStore::height() const {
+	return _header.height;
+}
+
+
+const FrameStore::Record& FrameStore::record(const unsigned frame) const {
+	assert(frame < _records.size());
+	return _records[frame];
+}
+
+
+bool FrameStore::read(const unsigned frame, const OnPixels& callback) const {
+	if(not isOpen() or frame >= _records.size())
+		return false;
+
+	const uint64_t start(offset(_records[frame].source));
+	const uint64_t size(sizeof(Record) + uint64_t(_header.width) *
+						_header.height * _header.pixel);
+	void* const slot(::mmap(0, size, PROT_READ, MAP_SHARED, _fd, start));
+
+	if(slot == MAP_FAILED)
+		return false;
+
+	const bool result(callback(static_cast<const byte*>(slot) +
+							   sizeof(Record)));
+	::munmap(slot, size);
+	release(_fd, start, size);
+	return result;
+}
+
+
+/**
+ * Reads the header and the records of the frames it counts, and checks
+ * that they fit the file.
+ */
+bool FrameStore::resume() {
+	_records.clear();
+
+	if(::pread(_fd, &_header, sizeof(Header), 0) != sizeof(Header) or
+	   std::memcmp(_header.magic, MAGIC, sizeof(MAGIC)) != 0 or
+	   _header.version != VERSION)
+		return false;
+
+	struct stat status;
+
+	if(::fstat(_fd, &status) != 0 or
+	   uint64_t(status.st_size) < offset(_header.count))
+		return false;
+
+	for(unsigned i(0); i != _header.count; ++i) {
+		Record record;
+
+		if(::pread(_fd, &record, sizeof(Record), offset(i)) !=
+		   sizeof(Record) or record.source > i or
+		   (record.source != i and
+			(not _records[record.source].keep or
+			 _records[record.source].source != record.source))) {
+			_records.clear();
+			return false;
+		}
+
+		_records.push_back(record);
+	}
+
+	return true;
+}
+
+
+bool FrameStore::writeHeader() {
+	_header.count = _records.size();
+	return ::pwrite(_fd, &_header, sizeof(Header), 0) == sizeof(Header);
+}
+
+
+bool FrameStore::writeRecord(const unsigned frame) {
+	return ::pwrite(_fd, &_records[frame], sizeof(Record), offset(frame)) ==
+		   sizeof(Record);
+}
+
+
+/// the first slot comes after that of the header
+uint64_t FrameStore::offset(const unsigned frame) const {
+	return ALIGNMENT + frame * stride();
+}
+
+
+uint64_t FrameStore::stride() const {
+	const uint64_t size(sizeof(Record) + uint64_t(_header.width) *
+						_header.height * _header.pixel);
+	return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// drops the clean pages from the page cache, where the system allows it
+void release(const int fd, const uint64_t offset, const uint64_t length) {
+#ifdef POSIX_FADV_DONTNEED
+	::posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+#else
+	(void) fd;
+	(void) offset;
+	(void) length;
+#endif
+}
@@ -0,0 +1,508 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "GifWriter.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+
+typedef GifWriter::byte byte;
+
+const byte EXTENSION(0x21);
+const byte IMAGE(0x2c);
+const byte TRAILER(0x3b);
+const byte GRAPHIC_CONTROL(0xf9);
+const byte COLOR_TABLE(0x80); // global or local color table flag
+const byte COLOR_RESOLUTION(0x70); // 8 bits
+const byte DO_NOT_DISPOSE(1 << 2);
+const byte TRANSPARENT(0x01); // transparent color flag
+const unsigned MIN_CODE_SIZE(2);
+const float TOLERANCE(1.25f); // error growth before the palette is updated
+const float MIN_ERROR(3.0f); // always tolerated, for exact palettes
+const unsigned NOT_KEPT(~0u);
+const unsigned MAX_DELAY(0xffff);
+const std::string SCRATCH_EXTENSION(".kept");
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void put16(std::ostream& out, const unsigned value);
+
+unsigned tableBits(const std::size_t colors);
+
+void putTable(std::ostream& out, const Quantizer::Palette& palette);
+
+inline uint32_t pack(const Quantizer::Color& c);
+
+inline int distance(const byte* const rgb, const uint32_t c);
+
+
+/* *****************************************************************************
+ * GifWriter implementation.
+ * ****************************************************************************/
+GifWriter::GifWriter(const PixelFormat format, const Dither::Method dither):
+	_format(format),
+	_width(0),
+	_height(0),
+	_frames(0),
+	_quantizer(Quantizer::MAX_COLORS - 1), // one left for transparency
+	_pool(encoderThreads()),
+	_dither(dither, &_pool),
+	_global(false),
+	_delay(0),
+	_palette_kept(false)
+{}
+
+
+GifWriter::~GifWriter() {
+	_store.remove();
+}
+
+
+bool GifWriter::open(const std::string& uri) {
+	if(_out.is_open())
+		_out.close();
+
+	_frames = 0;
+	_uri = uri;
+	_store.remove();
+	_palettes.clear();
+	_kept.clear();
+	_sources.clear();
+	_out.open(uri.c_str(), std::ios::binary | std::ios::trunc);
+	return _out.is_open();
+}
+
+
+/// the file is written as the frames come, there is nothing to resume
+bool GifWriter::resume(const uint64_t, std::vector<Stored>&) {
+	return false;
+}
+
+
+bool GifWriter::appendFrame(const unsigned w,
+							const unsigned h,
+							const byte* const bytes,
+							const unsigned delay,
+							const bool keep)
+{
+	if(not _out.is_open())
+		return false;
+
+	if(_frames == 0) {
+		_width = w;
+		_height = h;
+	}
+
+	if(w != _width or h != _height) {
+		std::cerr << "GifWriter::appendFrame: frame size " << w << "x" << h
+				  << " differs from " << _width << "x" << _height
+				  << std::endl;
+		return false;
+	}
+
+	const byte* const rgba(toRgba(bytes));
+	encode(rgba);
+
+	if(_frames == 0 and not writeHeader())
+		return false;
+
+	if(keep) {
+		if(not keepIndices())
+			return false;
+
+		if(not _palette_kept) {
+			_palettes.push_back(_quantizer.palette());
+			_palette_kept = true;
+		}
+
+		const Kept kept = {unsigned(_palettes.size() - 1), _global};
+		_sources.push_back(_kept.size());
+		_kept.push_back(kept);
+	}
+	else
+		_sources.push_back(NOT_KEPT);
+
+	crop(rgba, _quantizer.palette());
+
+	if(not writeFrame(delay, _quantizer.palette(), _global))
+		return false;
+
+	++_frames;
+	return true;
+}
+
+
+/**
+ * GIF has no way to refer to an earlier frame, so the kept one is written
+ * again, but from its palette indices: only crop() and the LZW encoder run.
+ * The current palette is left as is for the frames to come.
+ */
+bool GifWriter::repeatFrame(const unsigned frame, const unsigned delay) {
+	if(not _out.is_open() or frame >= _sources.size() or
+	   _sources[frame] == NOT_KEPT)
+		return false;
+
+	const unsigned source(_sources[frame]);
+	const Kept& kept(_kept[source]);
+	const Quantizer::Palette& palette(_palettes[kept.palette]);
+	_indices.resize(_width * _height);
+
+	if(not _store.read(source, [this](const byte* const indices) {
+		std::copy(indices, indices + _indices.size(), _indices.begin());
+		return true;
+	}))
+		return false;
+
+	crop(nullptr, palette);
+
+	if(not writeFrame(delay, palette, kept.global))
+		return false;
+
+	_sources.push_back(source);
+	++_frames;
+	return true;
+}
+
+
+/// the delay of the last frame is written again, in its place
+bool GifWriter::extendFrame(const unsigned delay) {
+	if(not _out.is_open() or _frames == 0 or _delay + delay > MAX_DELAY)
+		return false;
+
+	_delay += delay;
+	const std::streampos end(_out.tellp());
+	_out.seekp(_delayPos);
+	put16(_out, _delay);
+	_out.seekp(end);
+	_out.flush();
+	return _out.good();
+}
+
+
+bool GifWriter::finish() {
+	if(not _out.is_open())
+		return false;
+
+	const bool complete(_frames != 0);
+
+	if(complete)
+		_out.put(TRAILER);
+
+	_out.close();
+	_store.remove();
+	_palettes.clear();
+	_kept.clear();
+	_sources.clear();
+	return complete and not _out.fail();
+}
+
+
+/// nothing is kept to be resumed
+void GifWriter::cancel(const bool) {
+	_out.close();
+	_store.remove();
+	_palettes.clear();
+	_kept.clear();
+	_sources.clear();
+}
+
+
+/// the indices of the frame to the store, opened with the first of them
+bool GifWriter::keepIndices() {
+	if(not _store.isOpen() and
+	   not _store.open(_uri + SCRATCH_EXTENSION, 0, 1, false)) {
+		std::cerr << "GifWriter::appendFrame: can not open "
+				  << _uri + SCRATCH_EXTENSION << std::endl;
+		return false;
+	}
+
+	return _store.append(_width, _height, &_indices.front(), 0, false);
+}
+
+
+/**
+ * The global color table is the palette of the first frame.
+ * It is followed by the NETSCAPE2.0 extension to loop forever.
+ */
+bool GifWriter::writeHeader() {
+	const byte loop[] = {
+		EXTENSION, 0xff, 11,
+		'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+		3, 1, 0, 0, // sub-block 1, loop count 0
+		0
+	};
+
+	_out.write("GIF89a", 6);
+	put16(_out, _width);
+	put16(_out, _height);
+	_out.put(COLOR_TABLE | COLOR_RESOLUTION |
+			 (tableBits(_quantizer.palette().size() + 1) - 1));
+	_out.put(0); // background color
+	_out.put(0); // aspect ratio
+	putTable(_out, _quantizer.palette());
+	_out.write(reinterpret_cast<const char*>(loop), sizeof(loop));
+
+	_global = true;
+	return _out.good();
+}
+
+
+/// the frame in RGBA, converted if needed
+const byte* GifWriter::toRgba(const byte* const bytes) {
+	if(_format != RGB)
+		return bytes;
+
+	const unsigned n(_width * _height);
+	_rgba.resize(n * 4);
+
+	for(unsigned i(0); i != n; ++i) {
+		std::copy(bytes + i * 3, bytes + i * 3 + 3, &_rgba[i * 4]);
+		_rgba[i * 4 + 3] = 0xff;
+	}
+
+	return &_rgba.front();
+}
+
+
+/**
+ * Finds the palette index of every pixel. Morph frames change little from
+ * one to the next, so the palette is kept as long as its error on the frame
+ * stays within TOLERANCE of its error on the frame it was made for; it is
+ * only then updated, starting from its colors rather than from scratch.
+ * This saves both the quantization and the color tables.
+ */
+void GifWriter::encode(const byte* const rgba) {
+	const ConstImageView img(rgba, _width, _height);
+
+	if(_frames == 0) {
+		_quantizer.quantize(img);
+		_palette_kept = false;
+	}
+	else if(_quantizer.error(img) > std::max(_quantizer.error() * TOLERANCE,
+											 MIN_ERROR)) {
+		_quantizer.update();
+		_global = false;
+		_palette_kept = false;
+	}
+
+	_dither.map(img, _quantizer, _indices);
+}
+
+
+/**
+ * Finds the rectangle around the pixels to change, and keeps the indices in
+ * it only, those of the whole frame in 'palette'. A pixel is left as shown
+ * when its color there is at least as close to that in 'rgba' as its
+ * palette color or, if dithered, when it is its palette color, as the
+ * pattern would be lost otherwise. Without 'rgba', as when a frame is
+ * repeated, only the pixels already showing their palette color are left.
+ * Such pixels are given the transparent index, the one after the palette
+ * colors, so that they read as long runs of the same code to the LZW
+ * encoder. When most pixels of the rectangle change, all get their palette
+ * index instead. The first frame covers the whole canvas. A frame that
+ * changes nothing still has a single transparent pixel, to show for its
+ * delay.
+ */
+void GifWriter::crop(const byte* const rgba,
+					 const Quantizer::Palette& palette)
+{
+	const byte transparent(palette.size());
+	const unsigned n(_width * _height);
+	uint32_t colors[Quantizer::MAX_COLORS];
+
+	for(unsigned i(0); i != palette.size(); ++i)
+		colors[i] = pack(palette[i]);
+
+	if(_frames == 0) {
+		_canvas.resize(n);
+
+		for(unsigned i(0); i != n; ++i)
+			_canvas[i] = colors[_indices[i]];
+
+		const Rect all = {0, 0, _width, _height};
+		_rect = all;
+		return;
+	}
+
+	const bool exact(rgba == nullptr or _dither.method() != Dither::NONE);
+	unsigned left(_width), top(_height), right(0), bottom(0);
+	unsigned changed(0);
+	_changes.resize(n);
+
+	for(unsigned y(0); y != _height; ++y) {
+		const unsigned row(y * _width);
+		unsigned first(_width), last(0);
+
+		for(unsigned x(0); x != _width; ++x) {
+			const unsigned i(row + x);
+			const uint32_t color(colors[_indices[i]]);
+			const bool change(color != _canvas[i] and
+							  (exact or distance(rgba + i * 4, color) <
+										distance(rgba + i * 4, _canvas[i])));
+			_changes[i] = change;
+
+			if(change) {
+				first = std::min(first, x);
+				last = x + 1;
+				++changed;
+			}
+		}
+
+		if(last != 0) {
+			left = std::min(left, first);
+			right = std::max(right, last);
+			top = std::min(top, y);
+			bottom = y + 1;
+		}
+	}
+
+	if(changed == 0) {
+		const Rect none = {0, 0, 1, 1};
+		_rect = none;
+		_indices.assign(1, transparent);
+		return;
+	}
+
+	const Rect dirty = {left, top, right - left, bottom - top};
+	_rect = dirty;
+
+	// scattered transparent pixels break runs more than they make them
+	const bool opaque(changed * 2 > _rect.w * _rect.h);
+	byte* out(&_indices.front()); // rows move up, never past their input
+
+	for(unsigned y(top); y != bottom; ++y) {
+		const unsigned row(y * _width);
+
+		for(unsigned x(left); x != right; ++x, ++out) {
+			const unsigned i(row + x);
+
+			if(opaque or _changes[i]) {
+				_canvas[i] = colors[_indices[i]];
+				*out = _indices[i];
+			}
+			else
+				*out = transparent;
+		}
+	}
+
+	_indices.resize(_rect.w * _rect.h);
+}
+
+
+/**
+ * Writes the frame: a graphic control extension with the delay and the
+ * transparent index, the image descriptor, the local color table unless the
+ * palette is the global one, and the compressed indices.
+ * Frames are not disposed of, each one is drawn over those before.
+ */
+bool GifWriter::writeFrame(const unsigned delay,
+						   const Quantizer::Palette& palette,
+						   const bool global)
+{
+	const unsigned bits(tableBits(palette.size() + 1));
+
+	const byte control[] = {
+		EXTENSION, GRAPHIC_CONTROL, 4,
+		byte(DO_NOT_DISPOSE | (_frames == 0? 0 : TRANSPARENT)),
+		byte(delay & 0xff), byte((delay >> 8) & 0xff),
+		byte(palette.size()), 0
+	};
+	_delay = delay;
+	_delayPos = _out.tellp() + std::streamoff(4);
+	_out.write(reinterpret_cast<const char*>(control), sizeof(control));
+
+	_out.put(IMAGE);
+	put16(_out, _rect.x);
+	put16(_out, _rect.y);
+	put16(_out, _rect.w);
+	put16(_out, _rect.h);
+
+	if(global)
+		_out.put(0);
+	else {
+		_out.put(COLOR_TABLE | (bits - 1));
+		putTable(_out, palette);
+	}
+
+	_data.clear();
+	_lzw.encode(&_indices.front(), _indices.size(),
+				std::max(bits, MIN_CODE_SIZE), _data);
+	_out.write(reinterpret_cast<const char*>(&_data.front()), _data.size());
+	_out.flush();
+
+	return _out.good();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// little endian
+void put16(std::ostream& out, const unsigned value) {
+	out.put(char(value & 0xff));
+	out.put(char((value >> 8) & 0xff));
+}
+
+
+/// the bits of the index in a color table large enough for 'colors'
+unsigned tableBits(const std::size_t colors) {
+	unsigned bits(1);
+
+	while((std::size_t(1) << bits) < colors)
+		++bits;
+
+	return bits;
+}
+
+
+/// the colors, padded with black to the table size, with room for the
+/// transparent index
+void putTable(std::ostream& out, const Quantizer::Palette& palette) {
+	const unsigned size(1u << tableBits(palette.size() + 1));
+
+	for(unsigned i(0); i != size; ++i) {
+		const Quantizer::Color c(i < palette.size()?
+								 palette[i] : Quantizer::Color());
+		out.put(c.r);
+		out.put(c.g);
+		out.put(c.b);
+	}
+}
+
+
+/// the color in the low 24 bits, red first
+inline uint32_t pack(const Quantizer::Color& c) {
+	return c.r | c.g << 8 | c.b << 16;
+}
+
+
+/// squared euclidean distance to a packed color
+inline int distance(const byte* const rgb, const uint32_t c) {
+	const int dr(rgb[0] - int(c & 0xff));
+	const int dg(rgb[1] - int(c >> 8 & 0xff));
+	const int db(rgb[2] - int(c >> 16));
+	return dr * dr + dg * dg + db * db;
+}
@@ -0,0 +1,105 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "LatencyMeter.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+
+const char* const LATENCY_ENV("FFD_LATENCY");
+const unsigned REPORT_SAMPLES(300); // about 5 s of dragging at 60 Hz
+
+
+/* ************************************************************************** *
+ * LatencyMeter implementation
+ * ************************************************************************** */
+
+LatencyMeter::LatencyMeter(const std::string& name):
+	_name(name),
+	_has_input(false),
+	_has_painted(false),
+	_samples(0),
+	_total(Clock::duration::zero()),
+	_worst(Clock::duration::zero())
+{}
+
+
+void LatencyMeter::name(const std::string& name) {
+	_name = name;
+}
+
+
+bool LatencyMeter::enabled() {
+	static const bool on(std::getenv(LATENCY_ENV) != 0);
+	return on;
+}
+
+
+void LatencyMeter::input(const Clock::time_point& time) {
+	if(not enabled() or _has_input)
+		return;
+
+	_input = time;
+	_has_input = true;
+}
+
+
+void LatencyMeter::paint() {
+	if(not _has_input or _has_painted)
+		return; // a frame still to swap already shows the input
+
+	_painted = _input;
+	_has_painted = true;
+	_has_input = false;
+}
+
+
+void LatencyMeter::shown() {
+	if(not _has_painted)
+		return;
+
+	const Clock::duration latency(Clock::now() - _painted);
+	_has_painted = false;
+
+	_total += latency;
+	_worst = std::max(_worst, latency);
+
+	if(++_samples == REPORT_SAMPLES)
+		report();
+}
+
+
+void LatencyMeter::report() {
+	typedef std::chrono::duration<double, std::milli> ms;
+
+	std::cerr << _name << ": input to swap "
+			  << ms(_total).count() / _samples << " ms mean, "
+			  << ms(_worst).count() << " ms worst, over "
+			  << _samples << " frames" << std::endl;
+
+	_samples = 0;
+	_total = _worst = Clock::duration::zero();
+}
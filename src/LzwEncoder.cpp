@@ -0,0 +1,179 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "LzwEncoder.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+
+typedef LzwEncoder::byte byte;
+
+const unsigned MAX_CODE((1 << LzwEncoder::MAX_BITS) - 1);
+const unsigned HASH_BITS(14); // load factor below 1/4
+const unsigned HASH_SIZE(1 << HASH_BITS);
+const uint32_t EMPTY(~0u);
+const unsigned BLOCK_SIZE(255);
+
+
+/**
+ * @brief The BitPacker struct writes variable width codes least significant
+ * bit first, in sub-blocks prefixed by their size.
+ */
+struct BitPacker {
+	BitPacker(std::vector<byte>& out):
+		out(out),
+		bits(0),
+		count(0),
+		block(0)
+	{}
+
+	inline void put(const unsigned code, const unsigned size) {
+		bits |= uint32_t(code) << count;
+		count += size;
+
+		while(count >= 8) {
+			push(byte(bits & 0xff));
+			bits >>= 8;
+			count -= 8;
+		}
+	}
+
+	inline void push(const byte b) {
+		if(block == 0) {
+			block = out.size();
+			out.push_back(0);
+		}
+
+		out.push_back(b);
+
+		if(++out[block] == BLOCK_SIZE)
+			block = 0;
+	}
+
+	/// the last bits and the terminator
+	void flush() {
+		if(count != 0)
+			push(byte(bits & 0xff));
+
+		out.push_back(0);
+	}
+
+	std::vector<byte>& out;
+	uint32_t bits;
+	unsigned count;
+	std::size_t block; // position of the size of the open block, 0 if none
+};
+
+
+/* *****************************************************************************
+ * LzwEncoder implementation.
+ * ****************************************************************************/
+LzwEncoder::LzwEncoder():
+	_keys(HASH_SIZE, EMPTY),
+	_codes(HASH_SIZE)
+{}
+
+
+/**
+ * Code widths follow the decoder, which adds an entry after every code
+ * but the first after a clear and widens once the next entry needs it.
+ * When the table is full a clear code starts over.
+ */
+void LzwEncoder::encode(const byte* const indices,
+						const std::size_t n,
+						const unsigned min_code_size,
+						std::vector<byte>& out)
+{
+	assert(2 <= min_code_size and min_code_size <= 8);
+
+	const unsigned clear(1 << min_code_size);
+	const unsigned end(clear + 1);
+	unsigned size(min_code_size + 1);
+	unsigned next(clear + 2);
+
+	out.push_back(byte(min_code_size));
+	BitPacker packer(out);
+	packer.put(clear, size);
+	reset();
+
+	if(n != 0) {
+		unsigned prefix(indices[0]);
+		assert(prefix < clear);
+
+		for(std::size_t i(1); i != n; ++i) {
+			const unsigned index(indices[i]);
+			assert(index < clear);
+
+			const uint32_t key(prefix << 8 | index);
+			const int slot(find(key));
+
+			if(_keys[slot] == key) {
+				prefix = _codes[slot];
+				continue;
+			}
+
+			packer.put(prefix, size);
+
+			_keys[slot] = key;
+			_codes[slot] = next;
+
+			if(next == (1u << size) and size < MAX_BITS)
+				++size;
+
+			if(next++ == MAX_CODE) {
+				packer.put(clear, size);
+				size = min_code_size + 1;
+				next = clear + 2;
+				reset();
+			}
+
+			prefix = index;
+		}
+
+		packer.put(prefix, size);
+
+		// the decoder adds an entry after the last code too
+		if(next == (1u << size) and size < MAX_BITS)
+			++size;
+	}
+
+	packer.put(end, size);
+	packer.flush();
+}
+
+
+void LzwEncoder::reset() {
+	std::fill(_keys.begin(), _keys.end(), EMPTY);
+}
+
+
+/// the slot of 'key', or the empty slot where it goes
+int LzwEncoder::find(const uint32_t key) const {
+	unsigned slot((key * 2654435761u) >> (32 - HASH_BITS));
+
+	while(_keys[slot] != EMPTY and _keys[slot] != key)
+		slot = (slot + 1) & (HASH_SIZE - 1);
+
+	return slot;
+}
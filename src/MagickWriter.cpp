@@ -0,0 +1,296 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "MagickWriter.hpp"
+
+#include "FrameStore.hpp"
+
+#include <Magick++.h>
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+
+const char* const FORMATS[] = { "RGBA", "RGB" };
+const unsigned PIXEL_SIZES[] = { 4, 3 };
+const unsigned MAX_DELAY(0xffff); // as stored by GIF
+const std::string SCRATCH_EXTENSION(".frames");
+const MagickCore::MagickSizeType SPILL_MEMORY(256 << 20); // in bytes
+const MagickCore::MagickSizeType NO_LIMIT(~MagickCore::MagickSizeType(0));
+
+
+/**
+ * @brief The ResourceLimit struct caps a Magick resource during its
+ * lifetime. Past the memory and map limits, the pixels of new images are
+ * cached on disk.
+ */
+struct ResourceLimit {
+	ResourceLimit(const MagickCore::ResourceType type,
+				  const MagickCore::MagickSizeType limit):
+		type(type),
+		old(MagickCore::GetMagickResourceLimit(type))
+	{
+		MagickCore::SetMagickResourceLimit(type, std::min(limit, old));
+	}
+
+	~ResourceLimit() {
+		MagickCore::SetMagickResourceLimit(type, old);
+	}
+
+	const MagickCore::ResourceType type;
+	const MagickCore::MagickSizeType old;
+};
+
+
+struct MagickWriter::PImpl {
+	typedef Magick::Image Image;
+	typedef std::vector<Image> Frames;
+	Frames _frames;
+	std::string uri;
+	PixelFormat format;
+	bool spill;
+	FrameStore store; // the frames when spilling
+};
+
+
+MagickWriter::MagickWriter(const PixelFormat format, const bool spill)
+	: _pimpl(new PImpl)
+{
+	static bool once(false);
+
+	if(not once) {
+		Magick::InitializeMagick(0);
+		once = true;
+	}
+
+	_pimpl->format = format;
+	_pimpl->spill = spill;
+}
+
+
+MagickWriter::~MagickWriter() {}
+
+
+bool MagickWriter::open(const std::string& uri) {
+	_pimpl->_frames.clear();
+	_pimpl->store.close();
+	_pimpl->uri = uri;
+	return not uri.empty();
+}
+
+
+bool MagickWriter::resume(const uint64_t key, std::vector<Stored>& stored) {
+	FrameStore& store(_pimpl->store);
+
+	if(not _pimpl->spill or
+	   not store.open(_pimpl->uri + SCRATCH_EXTENSION, key,
+					  PIXEL_SIZES[_pimpl->format], true))
+		return false;
+
+	for(unsigned i(0); i != store.size(); ++i) {
+		const Stored frame = {store.record(i).frames,
+							  store.record(i).keep != 0};
+		stored.push_back(frame);
+	}
+
+	return store.size() != 0;
+}
+
+
+bool MagickWriter::appendFrame(const unsigned w,
+							   const unsigned h,
+							   const byte* const bytes,
+							   const unsigned delay,
+							   const bool keep)
+{
+	if(_pimpl->spill) {
+		FrameStore& store(_pimpl->store);
+
+		if(not store.isOpen() and
+		   not store.open(_pimpl->uri + SCRATCH_EXTENSION, 0,
+						  PIXEL_SIZES[_pimpl->format], false)) {
+			std::cerr << "MagickWriter::appendFrame: can not open "
+					  << _pimpl->uri + SCRATCH_EXTENSION << std::endl;
+			return false;
+		}
+
+		return store.append(w, h, bytes, delay, keep);
+	}
+
+	typedef Magick::Image Image;
+	try {
+		const char* const fmt(FORMATS[_pimpl->format]);
+		_pimpl->_frames.push_back(Image(w, h, fmt, Magick::CharPixel, bytes));
+		_pimpl->_frames.back().animationDelay(delay);
+	} catch(const Magick::Exception& e) {
+		std::cerr << "MagickWriter::appendFrame: Magick++ exception: "
+				  << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Every frame is kept anyway. Magick++ images share their pixels once
+ * copied, so the frame is repeated without a copy of its pixels.
+ */
+bool MagickWriter::repeatFrame(const unsigned frame, const unsigned delay) {
+	if(_pimpl->spill)
+		return _pimpl->store.repeat(frame, delay);
+
+	if(frame >= _pimpl->_frames.size())
+		return false;
+
+	try {
+		const Magick::Image image(_pimpl->_frames[frame]);
+		_pimpl->_frames.push_back(image);
+
+		if(image.animationDelay() != delay)
+			_pimpl->_frames.back().animationDelay(delay);
+	} catch(const Magick::Exception& e) {
+		std::cerr << "MagickWriter::repeatFrame: Magick++ exception: "
+				  << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+bool MagickWriter::extendFrame(const unsigned delay) {
+	if(_pimpl->spill) {
+		FrameStore& store(_pimpl->store);
+		return store.size() != 0 and
+			   store.record(store.size() - 1).delay + delay <= MAX_DELAY and
+			   store.extend(delay);
+	}
+
+	if(_pimpl->_frames.empty())
+		return false;
+
+	try {
+		Magick::Image& image(_pimpl->_frames.back());
+		const unsigned total(image.animationDelay() + delay);
+
+		if(total > MAX_DELAY)
+			return false;
+
+		image.animationDelay(total);
+	} catch(const Magick::Exception& e) {
+		std::cerr << "MagickWriter::extendFrame: Magick++ exception: "
+				  << e.what() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ * Magick++ writes every image at once, so spilled frames are all made
+ * images here, one at a time, the pages of each frame being released once
+ * Magick++ has copied its pixels. Meanwhile Magick is held to SPILL_MEMORY,
+ * past which it caches their pixels on disk rather than in memory.
+ * The scratch file is removed whether the animation could be written or
+ * not.
+ */
+bool MagickWriter::finish() {
+	const MagickCore::MagickSizeType limit(_pimpl->spill? SPILL_MEMORY :
+										   NO_LIMIT);
+	const ResourceLimit memory(MagickCore::MemoryResource, limit);
+	const ResourceLimit map(MagickCore::MapResource, limit);
+
+	if(_pimpl->spill and not readFrames())
+		return false;
+
+	if(_pimpl->_frames.empty() or _pimpl->uri.empty())
+		return false;
+
+	try {
+		Magick::writeImages(_pimpl->_frames.begin(),
+							_pimpl->_frames.end(),
+							_pimpl->uri);
+	} catch(const Magick::Exception& e) {
+		std::cerr << "MagickWriter::finish: Magick++ exception: "
+				  << e.what() << std::endl;
+		_pimpl->_frames.clear();
+		return false;
+	}
+
+	_pimpl->_frames.clear();
+	return true;
+}
+
+
+/// spilled frames are kept to be resumed, if asked and there are any
+void MagickWriter::cancel(const bool resume) {
+	_pimpl->_frames.clear();
+
+	if(resume and _pimpl->store.size() != 0)
+		_pimpl->store.close();
+	else
+		_pimpl->store.remove();
+}
+
+
+/// the images of the spilled frames, then the scratch file is removed
+bool MagickWriter::readFrames() {
+	typedef Magick::Image Image;
+	FrameStore& store(_pimpl->store);
+	PImpl::Frames& frames(_pimpl->_frames);
+	bool read(true);
+
+	try {
+		const char* const fmt(FORMATS[_pimpl->format]);
+		frames.reserve(store.size());
+
+		for(unsigned i(0); read and i != store.size(); ++i) {
+			const FrameStore::Record& record(store.record(i));
+
+			if(record.source == i)
+				read = store.read(i, [&](const byte* const pixels) {
+					frames.push_back(Image(store.width(), store.height(),
+										   fmt, Magick::CharPixel, pixels));
+					return true;
+				});
+			else
+				frames.push_back(frames[record.source]);
+
+			if(read and frames.back().animationDelay() != record.delay)
+				frames.back().animationDelay(record.delay);
+		}
+	} catch(const Magick::Exception& e) {
+		std::cerr << "MagickWriter::finish: Magick++ exception: "
+				  << e.what() << std::endl;
+		read = false;
+	}
+
+	store.remove();
+
+	if(not read)
+		frames.clear();
+
+	return read;
+}
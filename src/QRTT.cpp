@@ -23,6 +23,7 @@
  */
 
 #include "QRTT.hpp"
+#include "RenderThread.hpp"
 #include "glu.hpp"
 #include "vec.hpp"
 
@@ -30,17 +31,70 @@
 #include <cassert>
 
 
-QRTT::QRTT(QGLWidget* const widget, const QSize& dim):
-	_widget(widget)
+/* *****************************************************************************
+ * QRTTPool implementation.
+ * ****************************************************************************/
+QRTTPool::QRTTPool(const unsigned capacity):
+	_capacity(capacity)
+{}
+
+
+QRTTPool::~QRTTPool() {}
+
+
+QRTTPool::FBOPtr QRTTPool::acquire(const QSize& dim,
+								   const QGLFramebufferObjectFormat& format)
+{
+	for(unsigned i(_fbos.size()); i-- != 0;)
+		if(_fbos[i]->size() == dim and _fbos[i]->format() == format) {
+			FBOPtr fbo(std::move(_fbos[i]));
+			_fbos.erase(_fbos.begin() + i);
+			return fbo;
+		}
+
+	return FBOPtr(new QGLFramebufferObject(dim, format));
+}
+
+
+void QRTTPool::recycle(FBOPtr fbo) {
+	if(fbo == nullptr or not fbo->isValid() or _capacity == 0)
+		return;
+
+	if(_fbos.size() == _capacity)
+		_fbos.erase(_fbos.begin());
+
+	_fbos.push_back(std::move(fbo));
+}
+
+
+/* *****************************************************************************
+ * QRTT implementation.
+ * ****************************************************************************/
+QRTT::QRTT(QGLWidget* const widget,
+		   const QSize& dim,
+		   QRTTPool* const pool):
+	_widget(widget),
+	_pool(pool)
 {
 	assert(_widget != 0);
-	_fbo.reset(new QGLFramebufferObject(dim));
+
+	if(_widget->context() != QGLContext::currentContext())
+		_widget->makeCurrent();
+
+	if(_pool != nullptr)
+		_fbo = _pool->acquire(dim, QGLFramebufferObjectFormat());
+	else
+		_fbo.reset(new QGLFramebufferObject(dim));
+
 	bind();
 }
 
 
 QRTT::~QRTT() {
 	unbind();
+
+	if(_pool != nullptr)
+		_pool->recycle(std::move(_fbo));
 }
 
 
@@ -65,17 +119,31 @@ void QRTT::bind() {
 
 	assert(_fbo->bind());
 
-	cgl::view2D(cgl::uvec2(), cgl::uvec2(width(), height()));
+	// top to bottom, see image()
+	cgl::view2D(cgl::uvec2(), cgl::uvec2(width(), height()),
+				cgl::vec2(0.0f, 1.0f), cgl::vec2(1.0f, 0.0f));
 }
 
 
 void QRTT::unbind() {
 	assert(_fbo->release());
-	const cgl::uvec2 dim(_widget->width(), _widget->height());
-	cgl::view2D(cgl::uvec2(), dim);
+	const QSize size(RenderThread::size(_widget));
+	cgl::view2D(cgl::uvec2(), cgl::uvec2(size.width(), size.height()));
 }
 
 
+/**
+ * QGLFramebufferObject::toImage() would read the pixels, then flip and
+ * swizzle them into a premultiplied ARGB image, that callers converted to
+ * RGBA8888 once more.
+ */
 QImage QRTT::image() const {
-	return _fbo->toImage();
+	QImage img(width(), height(), QImage::Format_RGBA8888);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glPixelStorei(GL_PACK_ROW_LENGTH, img.bytesPerLine() / 4);
+	glReadPixels(0, 0, width(), height(), GL_RGBA, GL_UNSIGNED_BYTE,
+				 img.bits());
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	return img;
 }
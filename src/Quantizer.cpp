@@ -0,0 +1,501 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "Quantizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+typedef Quantizer::byte byte;
+
+const unsigned BIN_BITS(Quantizer::BIN_BITS);
+const unsigned BIN_SHIFT(Quantizer::BIN_SHIFT);
+const unsigned BINS(1 << (3 * BIN_BITS));
+const unsigned MAX_SAMPLES(1 << 16); // pixels put in the histogram
+const unsigned ITERATIONS(4); // of k-means, at most
+const unsigned NEIGHBOURS(32); // listed for each palette color
+
+
+/**
+ * @brief The Box struct is a range of points of the median cut, with the
+ * channel where their colors spread the most.
+ */
+struct Box {
+	unsigned begin, end;
+	unsigned channel;
+	float range;
+};
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+inline unsigned binOf(const byte r, const byte g, const byte b);
+
+inline float distance(const float* const rgb, const Quantizer::Color& c);
+
+inline float distance(const Quantizer::Color& a, const Quantizer::Color& b);
+
+template<typename P>
+Box makeBox(const std::vector<P>& points,
+			const unsigned begin,
+			const unsigned end);
+
+
+/* *****************************************************************************
+ * Quantizer implementation.
+ * ****************************************************************************/
+Quantizer::Quantizer(const unsigned colors):
+	_colors(std::min(std::max(colors, 2u), unsigned(MAX_COLORS))),
+	_table(BINS + 1, NONE), // see table()
+	_error(0.0f),
+	_spacing(0.0f)
+{}
+
+
+const Quantizer::Palette& Quantizer::quantize(const ConstImageView& img) {
+	histogram(img);
+	medianCut();
+	kMeans();
+	resetTable();
+	_error = measure();
+	return _palette;
+}
+
+
+const Quantizer::Palette& Quantizer::update() {
+	assert(not _palette.empty());
+	kMeans();
+	resetTable();
+	_error = measure();
+	return _palette;
+}
+
+
+void Quantizer::palette(const Palette& palette) {
+	assert(not palette.empty() and palette.size() <= MAX_COLORS);
+	_palette = palette;
+	resetTable();
+}
+
+
+const Quantizer::Palette& Quantizer::palette() const {
+	return _palette;
+}
+
+
+float Quantizer::error(const ConstImageView& img) {
+	assert(not _palette.empty());
+	histogram(img);
+	return measure();
+}
+
+
+float Quantizer::error() const {
+	return _error;
+}
+
+
+void Quantizer::map(const ConstImageView& img, std::vector<byte>& indices) {
+	assert(not _palette.empty());
+
+	unsigned last(0); // neighbour pixels often have close colors
+	indices.resize(img.width * img.height);
+	byte* out(indices.empty()? 0 : &indices.front());
+
+	for(unsigned y(0); y != img.height; ++y) {
+		const byte* p(img.row(y));
+
+		for(unsigned x(0); x != img.width; ++x, p += 4, ++out) {
+			const unsigned bin(binOf(p[0], p[1], p[2]));
+
+			if(_table[bin] == NONE)
+				fillBin(bin, last);
+
+			last = _table[bin];
+			*out = byte(_table[bin]);
+		}
+	}
+}
+
+
+void Quantizer::fill() {
+	assert(not _palette.empty());
+	unsigned last(0);
+
+	for(unsigned bin(0); bin != BINS; ++bin) {
+		if(_table[bin] == NONE)
+			fillBin(bin, last);
+
+		last = _table[bin];
+	}
+}
+
+
+const uint16_t* Quantizer::table() const {
+	return &_table.front();
+}
+
+
+float Quantizer::spacing() const {
+	return _spacing;
+}
+
+
+Quantizer::byte Quantizer::nearest(const int r, const int g, const int b) const
+{
+	assert(not _palette.empty());
+	const float rgb[3] = {float(r), float(g), float(b)};
+	return byte(nearest(rgb, 0));
+}
+
+
+/**
+ * Samples the pixels on a regular grid, at most MAX_SAMPLES of them,
+ * and keeps the mean color of each non empty bin.
+ */
+void Quantizer::histogram(const ConstImageView& img) {
+	const double pixels(double(img.width) * img.height);
+	const unsigned step(std::max(1.0, std::ceil(std::sqrt(pixels /
+															MAX_SAMPLES))));
+	const Bin empty = {0, 0, 0, 0};
+	_bins.assign(BINS, empty);
+
+	for(unsigned y(step / 2); y < img.height; y += step) {
+		const byte* const row(img.row(y));
+
+		for(unsigned x(step / 2); x < img.width; x += step) {
+			const byte* const p(row + x * 4);
+			Bin& bin(_bins[binOf(p[0], p[1], p[2])]);
+			++bin.count;
+			bin.r += p[0];
+			bin.g += p[1];
+			bin.b += p[2];
+		}
+	}
+
+	_points.clear();
+
+	for(unsigned i(0); i != BINS; ++i) {
+		const Bin& bin(_bins[i]);
+
+		if(bin.count == 0)
+			continue;
+
+		const float n(bin.count);
+		const Point point = {{bin.r / n, bin.g / n, bin.b / n}, bin.count, 0};
+		_points.push_back(point);
+	}
+}
+
+
+/**
+ * Splits the box with the widest channel at the weighted median of that
+ * channel until there are enough boxes, each box mean is a palette color.
+ */
+void Quantizer::medianCut() {
+	std::vector<Box> boxes;
+	boxes.reserve(_colors);
+
+	if(not _points.empty())
+		boxes.push_back(makeBox(_points, 0, _points.size()));
+
+	while(boxes.size() < _colors) {
+		unsigned widest(0);
+
+		for(unsigned i(1); i != boxes.size(); ++i)
+			if(boxes[i].range > boxes[widest].range)
+				widest = i;
+
+		if(boxes.empty() or boxes[widest].range <= 0.0f)
+			break;
+
+		const Box box(boxes[widest]);
+		const unsigned c(box.channel);
+		const Iterator begin(_points.begin() + box.begin);
+		const Iterator end(_points.begin() + box.end);
+
+		// the weighted median of the channel, to the unit
+		uint64_t counts[256] = {0}, total(0), count(0);
+
+		for(Iterator i(begin); i != end; ++i) {
+			counts[unsigned(i->rgb[c])] += i->count;
+			total += i->count;
+		}
+
+		unsigned median(0);
+
+		while((count += counts[median]) * 2 < total)
+			++median;
+
+		if(count == total) // keep the second box non empty
+			--median;
+
+		const Iterator middle(std::partition(begin, end,
+											 [c, median](const Point& p) {
+			return unsigned(p.rgb[c]) <= median;
+		}));
+		const unsigned split(middle - _points.begin());
+
+		if(split == box.begin or split == box.end) {
+			boxes[widest].range = 0.0f; // spread within one unit
+			continue;
+		}
+
+		boxes[widest] = makeBox(_points, box.begin, split);
+		boxes.push_back(makeBox(_points, split, box.end));
+	}
+
+	_palette.resize(std::max<std::size_t>(boxes.size(), 1));
+
+	for(unsigned i(0); i != boxes.size(); ++i) {
+		double r(0.0), g(0.0), b(0.0), n(0.0);
+
+		for(unsigned j(boxes[i].begin); j != boxes[i].end; ++j) {
+			Point& p(_points[j]);
+			r += p.rgb[0] * p.count;
+			g += p.rgb[1] * p.count;
+			b += p.rgb[2] * p.count;
+			n += p.count;
+			p.cluster = i;
+		}
+
+		const Color color = {byte(r / n + 0.5), byte(g / n + 0.5),
+							 byte(b / n + 0.5)};
+		_palette[i] = color;
+	}
+
+	if(boxes.empty()) {
+		const Color black = {0, 0, 0};
+		_palette[0] = black;
+	}
+}
+
+
+/**
+ * Lloyd iterations: moves each point to the cluster of the nearest palette
+ * color, then each color to the mean of its cluster.
+ */
+void Quantizer::kMeans() {
+	const unsigned k(_palette.size());
+	std::vector<double> sums(k * 4);
+
+	for(unsigned iteration(0); iteration != ITERATIONS; ++iteration) {
+		bool moved(false);
+		std::fill(sums.begin(), sums.end(), 0.0);
+		sortNeighbours();
+
+		for(unsigned i(0); i != _points.size(); ++i) {
+			Point& p(_points[i]);
+			const unsigned best(nearest(p.rgb, p.cluster));
+			moved = moved or best != p.cluster;
+			p.cluster = best;
+
+			double* const sum(&sums[best * 4]);
+			sum[0] += p.rgb[0] * p.count;
+			sum[1] += p.rgb[1] * p.count;
+			sum[2] += p.rgb[2] * p.count;
+			sum[3] += p.count;
+		}
+
+		for(unsigned j(0); j != k; ++j) {
+			const double* const sum(&sums[j * 4]);
+
+			if(sum[3] == 0.0)
+				continue;
+
+			const Color color = {byte(sum[0] / sum[3] + 0.5),
+								 byte(sum[1] / sum[3] + 0.5),
+								 byte(sum[2] / sum[3] + 0.5)};
+			_palette[j] = color;
+		}
+
+		if(not moved and iteration != 0)
+			break;
+	}
+}
+
+
+/**
+ * Lists, for each palette color, the NEIGHBOURS colors nearest to it, by
+ * distance and starting with itself, each entry the squared distance
+ * shifted left by 8 bits or'ed with the index of the color.
+ */
+void Quantizer::sortNeighbours() {
+	const unsigned k(_palette.size());
+	const unsigned m(std::min(k, NEIGHBOURS));
+	std::vector<uint32_t> all(k);
+	double spacing(0.0);
+	_neighbours.resize(k * m);
+
+	for(unsigned i(0); i != k; ++i) {
+		for(unsigned j(0); j != k; ++j)
+			all[j] = uint32_t(distance(_palette[i], _palette[j])) << 8 | j;
+
+		std::nth_element(all.begin(), all.begin() + m - 1, all.end());
+		std::sort(all.begin(), all.begin() + m);
+		std::copy(all.begin(), all.begin() + m, _neighbours.begin() + i * m);
+
+		if(m > 1)
+			spacing += std::sqrt(float(all[1] >> 8));
+	}
+
+	_spacing = float(spacing / k);
+}
+
+
+/**
+ * Starts at the color 'guess' and visits its neighbours by distance to it.
+ * Once a color is more than twice as far from 'guess' as 'rgb' is, none of
+ * those left can be nearer to 'rgb' than 'guess', by the triangle
+ * inequality, and the search stops. When the neighbours run out before
+ * that, all the colors are searched.
+ */
+unsigned Quantizer::nearest(const float* const rgb, const unsigned guess) const
+{
+	const unsigned k(_palette.size());
+	const unsigned m(std::min(k, NEIGHBOURS));
+	const uint32_t* const near(&_neighbours[guess * m]);
+	unsigned best(guess);
+	float best_distance(distance(rgb, _palette[guess]));
+	const float bound(4.0f * best_distance); // squared
+	unsigned j(1);
+
+	for(; j != m and float(near[j] >> 8) <= bound; ++j) {
+		const unsigned index(near[j] & 0xff);
+		const float d(distance(rgb, _palette[index]));
+
+		if(d < best_distance) {
+			best_distance = d;
+			best = index;
+		}
+	}
+
+	if(j == m and m != k)
+		for(unsigned index(0); index != k; ++index) {
+			const float d(distance(rgb, _palette[index]));
+
+			if(d < best_distance) {
+				best_distance = d;
+				best = index;
+			}
+		}
+
+	return best;
+}
+
+
+/**
+ * Moves each point to the cluster of its nearest palette color.
+ * @return the mean squared distance of the points to their color.
+ */
+float Quantizer::measure() {
+	double sum(0.0), count(0.0);
+
+	for(unsigned i(0); i != _points.size(); ++i) {
+		Point& p(_points[i]);
+		p.cluster = nearest(p.rgb, i == 0? 0 : _points[i - 1].cluster);
+		sum += distance(p.rgb, _palette[p.cluster]) * p.count;
+		count += p.count;
+	}
+
+	return count == 0.0? 0.0f : float(sum / count);
+}
+
+
+/**
+ * Finds the palette color nearest to the center of the bin, so that the
+ * index does not depend on the pixel the bin is met with.
+ */
+void Quantizer::fillBin(const unsigned bin, const unsigned guess) {
+	const unsigned mask((1 << BIN_BITS) - 1);
+	const unsigned half(1 << BIN_SHIFT >> 1);
+	const float center[3] = {
+		float((bin >> (2 * BIN_BITS) & mask) << BIN_SHIFT | half),
+		float((bin >> BIN_BITS & mask) << BIN_SHIFT | half),
+		float((bin & mask) << BIN_SHIFT | half)
+	};
+	_table[bin] = nearest(center, guess);
+}
+
+
+void Quantizer::resetTable() {
+	std::fill(_table.begin(), _table.end(), NONE);
+	sortNeighbours();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+inline unsigned binOf(const byte r, const byte g, const byte b) {
+	return (r >> BIN_SHIFT) << (2 * BIN_BITS) | (g >> BIN_SHIFT) << BIN_BITS |
+		   (b >> BIN_SHIFT);
+}
+
+
+/// squared euclidean distance
+inline float distance(const float* const rgb, const Quantizer::Color& c) {
+	const float dr(rgb[0] - c.r), dg(rgb[1] - c.g), db(rgb[2] - c.b);
+	return dr * dr + dg * dg + db * db;
+}
+
+
+inline float distance(const Quantizer::Color& a, const Quantizer::Color& b) {
+	const float rgb[3] = {float(a.r), float(a.g), float(a.b)};
+	return distance(rgb, b);
+}
+
+
+/// the bounds of the points in [begin, end) and their widest channel
+template<typename P>
+Box makeBox(const std::vector<P>& points,
+			const unsigned begin,
+			const unsigned end)
+{
+	float lo[3] = {255.0f, 255.0f, 255.0f}, hi[3] = {0.0f, 0.0f, 0.0f};
+
+	for(unsigned i(begin); i != end; ++i) {
+		const float* const c(points[i].rgb);
+
+		for(unsigned j(0); j != 3; ++j) {
+			lo[j] = std::min(lo[j], c[j]);
+			hi[j] = std::max(hi[j], c[j]);
+		}
+	}
+
+	Box box = {begin, end, 0, hi[0] - lo[0]};
+
+	for(unsigned j(1); j != 3; ++j)
+		if(hi[j] - lo[j] > box.range) {
+			box.channel = j;
+			box.range = hi[j] - lo[j];
+		}
+
+	if(end - begin < 2)
+		box.range = 0.0f;
+
+	return box;
+}
@@ -0,0 +1,418 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Rasterizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if SIMD_X86
+#include <immintrin.h>
+#elif SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+
+typedef long long int64;
+typedef Rasterizer::Span Span;
+typedef Rasterizer::Spans Spans;
+
+const int SUBPIXEL_BITS(Rasterizer::SUBPIXEL_BITS);
+const int SUBPIXEL_ONE(Rasterizer::SUBPIXEL_ONE);
+const int SUBPIXEL_HALF(SUBPIXEL_ONE / 2);
+const int MAX_COORDINATE(16384 * SUBPIXEL_ONE);
+// Edge values are clamped to this before going into 32 bit lanes. The steps
+// are at most 2^23 so a whole vector of pixels never changes the sign of a
+// clamped value, and never overflows.
+const int64 EDGE_LIMIT(1 << 30);
+
+
+/**
+ * @brief The Setup struct holds the three edge functions of a triangle.
+ * The edge function of a pixel center is
+ * e = dx * (py - v.y) - dy * (px - v.x) with everything in fixed point,
+ * and the pixel is inside when e + bias >= 0 for all the edges.
+ * As pixel centers are at k * SUBPIXEL_ONE + SUBPIXEL_HALF that is
+ * the same as dx * y - dy * x + floor(k / SUBPIXEL_ONE) >= 0 in pixels,
+ * where k has all the constant terms. The later needs one less multiply
+ * and its steps are small enough for 32 bit lanes.
+ */
+struct Rasterizer::Setup {
+	int x0, y0, x1, y1; // pixel bounding box, inclusive
+	int64 row[3]; // edge values at (x0, y0)
+	int step_x[3];
+	int step_y[3];
+};
+
+typedef Rasterizer::Setup Setup;
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+bool isTopLeft(const Rasterizer::Point& a, const Rasterizer::Point& b);
+
+int clampEdge(const int64 e);
+
+void scanScalar(const Setup& s, Spans& spans);
+
+#if SIMD_X86
+void scanSSE2(const Setup& s, Spans& spans);
+void scanAVX2(const Setup& s, Spans& spans);
+#elif SIMD_NEON
+void scanNEON(const Setup& s, Spans& spans);
+#endif
+
+
+/* *****************************************************************************
+ * Rasterizer implementation.
+ * ****************************************************************************/
+Rasterizer::Rasterizer(const SimdLevel level):
+	_level(SIMD_SCALAR),
+	_scan(&scanScalar)
+{
+#if SIMD_X86
+	if(level == SIMD_AVX2) {
+		_level = level;
+		_scan = &scanAVX2;
+	} else if(level == SIMD_SSE2) {
+		_level = level;
+		_scan = &scanSSE2;
+	}
+#elif SIMD_NEON
+	if(level == SIMD_NEON_LEVEL) {
+		_level = level;
+		_scan = &scanNEON;
+	}
+#endif
+}
+
+
+int Rasterizer::toFixed(const float f) {
+	return int(std::floor(f * SUBPIXEL_ONE + 0.5f));
+}
+
+
+unsigned Rasterizer::triangle(const Point& a,
+							  const Point& b,
+							  const Point& c,
+							  const unsigned width,
+							  const unsigned height,
+							  Spans& spans) const
+{
+	return triangle(a, b, c, 0, 0, width, height, spans);
+}
+
+
+unsigned Rasterizer::triangle(const Point& a,
+							  const Point& b,
+							  const Point& c,
+							  const int x0,
+							  const int y0,
+							  const int x1,
+							  const int y1,
+							  Spans& spans) const
+{
+	assert(std::abs(a.x) <= MAX_COORDINATE and std::abs(a.y) <= MAX_COORDINATE);
+	assert(std::abs(b.x) <= MAX_COORDINATE and std::abs(b.y) <= MAX_COORDINATE);
+	assert(std::abs(c.x) <= MAX_COORDINATE and std::abs(c.y) <= MAX_COORDINATE);
+
+	const int64 area((int64(b.x) - a.x) * (int64(c.y) - a.y) -
+					 (int64(b.y) - a.y) * (int64(c.x) - a.x));
+
+	if(area == 0)
+		return 0;
+
+	// counter clockwise (in y down) triangles have all the edges positive.
+	const Point* const v[3] = {&b, area > 0? &c : &a, area > 0? &a : &c};
+	const Point* const w[3] = {v[1], v[2], v[0]};
+
+	Setup s;
+	const int ceil(SUBPIXEL_ONE - 1 - SUBPIXEL_HALF);
+	const int min_x(std::min(std::min(a.x, b.x), c.x));
+	const int min_y(std::min(std::min(a.y, b.y), c.y));
+	const int max_x(std::max(std::max(a.x, b.x), c.x));
+	const int max_y(std::max(std::max(a.y, b.y), c.y));
+	s.x0 = std::max(x0, (min_x + ceil) >> SUBPIXEL_BITS);
+	s.y0 = std::max(y0, (min_y + ceil) >> SUBPIXEL_BITS);
+	s.x1 = std::min(x1 - 1, (max_x - SUBPIXEL_HALF) >> SUBPIXEL_BITS);
+	s.y1 = std::min(y1 - 1, (max_y - SUBPIXEL_HALF) >> SUBPIXEL_BITS);
+
+	if(s.x0 > s.x1 or s.y0 > s.y1)
+		return 0;
+
+	for(unsigned i(0); i != 3; ++i) {
+		const int64 dx(w[i]->x - v[i]->x);
+		const int64 dy(w[i]->y - v[i]->y);
+		const int64 bias(isTopLeft(*v[i], *w[i])? 0 : -1);
+		const int64 k(dx * (SUBPIXEL_HALF - v[i]->y) -
+					  dy * (SUBPIXEL_HALF - v[i]->x) + bias);
+
+		s.step_x[i] = -dy;
+		s.step_y[i] = dx;
+		s.row[i] = dx * s.y0 - dy * s.x0 + (k >> SUBPIXEL_BITS); // floor
+	}
+
+	const unsigned size(spans.size());
+	_scan(s, spans);
+	return spans.size() - size;
+}
+
+
+/* *****************************************************************************
+ * Scan implementations.
+ * Each one walks the rows of the bounding box and stops a row as soon as it
+ * leaves the triangle, which is convex.
+ * ****************************************************************************/
+void scanScalar(const Setup& s, Spans& spans) {
+	int64 row[3] = {s.row[0], s.row[1], s.row[2]};
+
+	for(int y(s.y0); y <= s.y1; ++y) {
+		int64 e[3] = {row[0], row[1], row[2]};
+		int first(-1), last(-1);
+
+		for(int x(s.x0); x <= s.x1; ++x) {
+			if((e[0] | e[1] | e[2]) >= 0) {
+				if(first < 0)
+					first = x;
+				last = x;
+			} else if(first >= 0)
+				break;
+
+			for(unsigned i(0); i != 3; ++i)
+				e[i] += s.step_x[i];
+		}
+
+		if(first >= 0)
+			spans.push_back(Span(y, first, last + 1));
+
+		for(unsigned i(0); i != 3; ++i)
+			row[i] += s.step_y[i];
+	}
+}
+
+
+/**
+ * @brief scanRows the common row walk of the vector versions.
+ * 'Lanes' evaluates the inside mask of 'Lanes::WIDTH' pixels starting at
+ * the given clamped edge values, bit i set if pixel i is inside.
+ */
+template<typename Lanes>
+inline void scanRows(const Setup& s, const Lanes& lanes, Spans& spans) {
+	const int W(Lanes::WIDTH);
+	const unsigned all((1u << (W - 1)) | ((1u << (W - 1)) - 1));
+	const unsigned msb(1u << (W - 1));
+	int64 row[3] = {s.row[0], s.row[1], s.row[2]};
+	const int64 block_step[3] = {
+		int64(s.step_x[0]) * W, int64(s.step_x[1]) * W, int64(s.step_x[2]) * W
+	};
+
+	for(int y(s.y0); y <= s.y1; ++y) {
+		int64 e[3] = {row[0], row[1], row[2]};
+		int first(-1), last(-1);
+
+		for(int x(s.x0); x <= s.x1; x += W) {
+			unsigned mask(lanes(clampEdge(e[0]), clampEdge(e[1]),
+								clampEdge(e[2])));
+
+			const int valid(s.x1 - x + 1);
+			if(valid < W)
+				mask &= ~(all << valid) & all;
+
+			if(mask != 0) {
+				if(first < 0)
+					first = x + __builtin_ctz(mask);
+				last = x + 31 - __builtin_clz(mask);
+			}
+
+			if(first >= 0 and not (mask & msb))
+				break;
+
+			for(unsigned i(0); i != 3; ++i)
+				e[i] += block_step[i];
+		}
+
+		if(first >= 0)
+			spans.push_back(Span(y, first, last + 1));
+
+		for(unsigned i(0); i != 3; ++i)
+			row[i] += s.step_y[i];
+	}
+}
+
+
+#if SIMD_X86
+/// 8 pixels per step, as two vectors of 4 lanes.
+struct SSE2Lanes {
+	static const int WIDTH = 8;
+
+	SIMD_TARGET("sse2")
+	SSE2Lanes(const Setup& s) {
+		for(unsigned i(0); i != 3; ++i) {
+			const int d(s.step_x[i]);
+			lo[i] = _mm_setr_epi32(0, d, 2 * d, 3 * d);
+			hi[i] = _mm_add_epi32(lo[i], _mm_set1_epi32(4 * d));
+		}
+	}
+
+	SIMD_TARGET("sse2")
+	inline unsigned operator()(const int e0, const int e1, const int e2) const {
+		const __m128i v0(_mm_set1_epi32(e0));
+		const __m128i v1(_mm_set1_epi32(e1));
+		const __m128i v2(_mm_set1_epi32(e2));
+
+		// any negative edge sets the sign bit
+		const __m128i l(_mm_or_si128(_mm_or_si128(_mm_add_epi32(v0, lo[0]),
+												  _mm_add_epi32(v1, lo[1])),
+									 _mm_add_epi32(v2, lo[2])));
+		const __m128i h(_mm_or_si128(_mm_or_si128(_mm_add_epi32(v0, hi[0]),
+												  _mm_add_epi32(v1, hi[1])),
+									 _mm_add_epi32(v2, hi[2])));
+
+		const unsigned outside(_mm_movemask_ps(_mm_castsi128_ps(l)) |
+							   (_mm_movemask_ps(_mm_castsi128_ps(h)) << 4));
+		return ~outside & 0xffu;
+	}
+
+	__m128i lo[3], hi[3];
+};
+
+
+/// 16 pixels per step, as two vectors of 8 lanes.
+struct AVX2Lanes {
+	static const int WIDTH = 16;
+
+	SIMD_TARGET("avx2")
+	AVX2Lanes(const Setup& s) {
+		const __m256i idx(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+		for(unsigned i(0); i != 3; ++i) {
+			const int d(s.step_x[i]);
+			lo[i] = _mm256_mullo_epi32(idx, _mm256_set1_epi32(d));
+			hi[i] = _mm256_add_epi32(lo[i], _mm256_set1_epi32(8 * d));
+		}
+	}
+
+	SIMD_TARGET("avx2")
+	inline unsigned operator()(const int e0, const int e1, const int e2) const {
+		const __m256i v0(_mm256_set1_epi32(e0));
+		const __m256i v1(_mm256_set1_epi32(e1));
+		const __m256i v2(_mm256_set1_epi32(e2));
+
+		const __m256i l(_mm256_or_si256(
+			_mm256_or_si256(_mm256_add_epi32(v0, lo[0]),
+							_mm256_add_epi32(v1, lo[1])),
+			_mm256_add_epi32(v2, lo[2])));
+		const __m256i h(_mm256_or_si256(
+			_mm256_or_si256(_mm256_add_epi32(v0, hi[0]),
+							_mm256_add_epi32(v1, hi[1])),
+			_mm256_add_epi32(v2, hi[2])));
+
+		const unsigned outside(_mm256_movemask_ps(_mm256_castsi256_ps(l)) |
+							   (_mm256_movemask_ps(_mm256_castsi256_ps(h)) << 8));
+		return ~outside & 0xffffu;
+	}
+
+	__m256i lo[3], hi[3];
+};
+
+
+SIMD_TARGET("sse2") SIMD_FLATTEN
+void scanSSE2(const Setup& s, Spans& spans) {
+	scanRows(s, SSE2Lanes(s), spans);
+}
+
+
+SIMD_TARGET("avx2") SIMD_FLATTEN
+void scanAVX2(const Setup& s, Spans& spans) {
+	scanRows(s, AVX2Lanes(s), spans);
+}
+#endif // SIMD_X86
+
+
+#if SIMD_NEON
+/// 8 pixels per step, as two vectors of 4 lanes.
+struct NEONLanes {
+	static const int WIDTH = 8;
+
+	NEONLanes(const Setup& s) {
+		const int32_t idx[4] = {0, 1, 2, 3};
+		const int32x4_t i4(vld1q_s32(idx));
+
+		for(unsigned i(0); i != 3; ++i) {
+			const int d(s.step_x[i]);
+			lo[i] = vmulq_n_s32(i4, d);
+			hi[i] = vaddq_s32(lo[i], vdupq_n_s32(4 * d));
+		}
+
+		const int32_t shifts[4] = {0, 1, 2, 3};
+		bits = vld1q_s32(shifts);
+	}
+
+	inline unsigned operator()(const int e0, const int e1, const int e2) const {
+		const int32x4_t v0(vdupq_n_s32(e0));
+		const int32x4_t v1(vdupq_n_s32(e1));
+		const int32x4_t v2(vdupq_n_s32(e2));
+
+		const int32x4_t l(vorrq_s32(vorrq_s32(vaddq_s32(v0, lo[0]),
+											  vaddq_s32(v1, lo[1])),
+									vaddq_s32(v2, lo[2])));
+		const int32x4_t h(vorrq_s32(vorrq_s32(vaddq_s32(v0, hi[0]),
+											  vaddq_s32(v1, hi[1])),
+									vaddq_s32(v2, hi[2])));
+
+		// sign bits to a bit mask
+		const uint32x4_t ls(vshrq_n_u32(vreinterpretq_u32_s32(l), 31));
+		const uint32x4_t hs(vshrq_n_u32(vreinterpretq_u32_s32(h), 31));
+		const unsigned outside(vaddvq_u32(vshlq_u32(ls, bits)) |
+							   (vaddvq_u32(vshlq_u32(hs, bits)) << 4));
+		return ~outside & 0xffu;
+	}
+
+	int32x4_t lo[3], hi[3];
+	int32x4_t bits;
+};
+
+
+SIMD_FLATTEN
+void scanNEON(const Setup& s, Spans& spans) {
+	scanRows(s, NEONLanes(s), spans);
+}
+#endif // SIMD_NEON
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+bool isTopLeft(const Rasterizer::Point& a, const Rasterizer::Point& b) {
+	const int de_dx(a.y - b.y);
+	const int de_dy(b.x - a.x);
+	return de_dx > 0 or (de_dx == 0 and de_dy > 0);
+}
+
+
+int clampEdge(const int64 e) {
+	return int(std::min(std::max(e, -EDGE_LIMIT), EDGE_LIMIT));
+}
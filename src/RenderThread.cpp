@@ -0,0 +1,304 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "RenderThread.hpp"
+
+#include <QGLWidget>
+#include <QOpenGLContext>
+
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+
+typedef std::lock_guard<std::mutex> Lock;
+typedef std::unique_lock<std::mutex> UniqueLock;
+
+
+/**
+ * @brief The Target struct is a widget painted by the thread and what was
+ * requested for it, 'viewport' and 'initialized' are only touched by the
+ * thread.
+ */
+struct Target {
+	Target(QGLWidget* const widget, const RenderThread::View& view):
+		widget(widget),
+		view(view),
+		paint(false),
+		resize(false),
+		viewport(widget->size() * widget->devicePixelRatio()),
+		initialized(false)
+	{}
+
+	QGLWidget* widget;
+	RenderThread::View view;
+	QSize size;
+	bool paint;
+	bool resize;
+	QSize viewport; // the size last given to view.resize
+	bool initialized;
+};
+
+
+struct RenderThread::PImpl {
+	PImpl();
+
+	Target& find(const QGLWidget* const widget);
+
+	bool pending() const;
+
+	void render(Target& target, const bool resize, const QSize& size);
+
+
+	QThread* const owner; // where the contexts go back to
+	std::vector<Target> targets; // fixed once running
+
+	std::mutex mutex; // everything below and the requests of the targets
+	std::condition_variable wake;
+	std::condition_variable done;
+	const Task* task;
+	QGLWidget* task_widget;
+	bool stop;
+};
+
+
+/* ************************************************************************** *
+ * RenderThread implementation
+ * ************************************************************************** */
+
+RenderThread::RenderThread(QObject* const parent):
+	QThread(parent),
+	_pimpl(new PImpl)
+{}
+
+
+RenderThread::~RenderThread() {
+	if(isRunning())
+		stop();
+}
+
+
+void RenderThread::add(QGLWidget* const widget, const View& view) {
+	assert(not isRunning());
+	assert(owner(widget) == nullptr);
+
+	widget->doneCurrent();
+	widget->context()->moveToThread(this);
+	_pimpl->targets.push_back(Target(widget, view));
+}
+
+
+void RenderThread::paint(QGLWidget* const widget) {
+	PImpl& p(*_pimpl);
+
+	{
+		const Lock lock(p.mutex);
+		p.find(widget).paint = true;
+	}
+
+	p.wake.notify_one();
+}
+
+
+/// the widget is painted again at its new size
+void RenderThread::resize(QGLWidget* const widget, const QSize& size) {
+	PImpl& p(*_pimpl);
+
+	{
+		const Lock lock(p.mutex);
+		Target& target(p.find(widget));
+		target.size = size;
+		target.resize = true;
+		target.paint = true;
+	}
+
+	p.wake.notify_one();
+}
+
+
+void RenderThread::stop() {
+	PImpl& p(*_pimpl);
+
+	{
+		const Lock lock(p.mutex);
+		p.stop = true;
+	}
+
+	p.wake.notify_one();
+	wait();
+}
+
+
+RenderThread* RenderThread::owner(const QGLWidget* const widget) {
+	const QOpenGLContext* const context(widget->context()->contextHandle());
+
+	if(context == nullptr)
+		return nullptr;
+
+	return qobject_cast<RenderThread*>(context->thread());
+}
+
+
+/**
+ * The targets are fixed once running and their viewport is only touched by
+ * the thread, so it is read there without locking.
+ */
+QSize RenderThread::size(const QGLWidget* const widget) {
+	RenderThread* const thread(owner(widget));
+
+	if(thread == nullptr or thread != QThread::currentThread())
+		return widget->size();
+
+	return thread->_pimpl->find(widget).viewport;
+}
+
+
+void RenderThread::call(QGLWidget* const widget, const Task& task) {
+	RenderThread* const thread(owner(widget));
+
+	if(thread == nullptr or thread == QThread::currentThread()) {
+		if(widget->context() != QGLContext::currentContext())
+			widget->makeCurrent();
+
+		task();
+		return;
+	}
+
+	PImpl& p(*thread->_pimpl);
+	UniqueLock lock(p.mutex);
+	p.done.wait(lock, [&p]() { return p.task == nullptr; });
+	p.task = &task;
+	p.task_widget = widget;
+	p.wake.notify_one();
+	p.done.wait(lock, [&p, &task]() { return p.task != &task; });
+}
+
+
+void RenderThread::run() {
+	PImpl& p(*_pimpl);
+	UniqueLock lock(p.mutex);
+
+	for(;;) {
+		p.wake.wait(lock, [&p]() {
+			return p.stop or p.task != nullptr or p.pending();
+		});
+
+		if(p.task != nullptr) {
+			QGLWidget* const widget(p.task_widget);
+			const Task& task(*p.task);
+
+			lock.unlock();
+			widget->makeCurrent();
+			task();
+			widget->doneCurrent();
+			lock.lock();
+
+			p.task = nullptr;
+			p.done.notify_all();
+		}
+		else if(p.pending()) {
+			for(unsigned i(0); i != p.targets.size(); ++i) {
+				Target& target(p.targets[i]);
+
+				if(not target.paint)
+					continue;
+
+				const bool resize(target.resize);
+				const QSize size(target.size);
+				target.paint = target.resize = false;
+
+				lock.unlock(); // new requests come in while painting
+				p.render(target, resize, size);
+				lock.lock();
+			}
+		}
+		else
+			break; // stopped with nothing left to do
+	}
+
+	lock.unlock();
+
+	// only the thread owning an object can move it
+	for(unsigned i(0); i != p.targets.size(); ++i)
+		p.targets[i].widget->context()->moveToThread(p.owner);
+}
+
+
+/* ************************************************************************** *
+ * RenderThread::PImpl implementation
+ * ************************************************************************** */
+
+RenderThread::PImpl::PImpl():
+	owner(QThread::currentThread()),
+	task(nullptr),
+	task_widget(nullptr),
+	stop(false)
+{}
+
+
+Target& RenderThread::PImpl::find(const QGLWidget* const widget) {
+	for(unsigned i(0); i != targets.size(); ++i)
+		if(targets[i].widget == widget)
+			return targets[i];
+
+	assert(false); // not added
+	return targets.front();
+}
+
+
+bool RenderThread::PImpl::pending() const {
+	for(unsigned i(0); i != targets.size(); ++i)
+		if(targets[i].paint)
+			return true;
+
+	return false;
+}
+
+
+void RenderThread::PImpl::render(Target& target,
+								 const bool resize,
+								 const QSize& size)
+{
+	QGLWidget* const widget(target.widget);
+	widget->makeCurrent();
+
+	if(resize)
+		target.viewport = size; // for initialize too
+
+	if(not target.initialized) {
+		target.view.initialize();
+		target.initialized = true;
+	}
+
+	if(resize)
+		target.view.resize(size.width(), size.height());
+
+	target.view.paint();
+	widget->swapBuffers(); // waits for the display, not the GUI thread
+	widget->doneCurrent();
+
+	if(target.view.swapped)
+		target.view.swapped();
+}
@@ -0,0 +1,648 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Sampler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if SIMD_X86
+#include <immintrin.h>
+#elif SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+
+typedef Sampler::byte byte;
+typedef Sampler::Texture Texture;
+
+const int FRACTION_BITS(Sampler::FRACTION_BITS);
+const int WEIGHT_BITS(8); // bilinear weights precision.
+const int WEIGHT_ONE(1 << WEIGHT_BITS);
+const int WEIGHT_ROUND(WEIGHT_ONE / 2);
+const int TO_WEIGHT_BITS(FRACTION_BITS - WEIGHT_BITS);
+const int TO_WEIGHT_ROUND(1 << (TO_WEIGHT_BITS - 1));
+const unsigned CHANNELS(4);
+const unsigned PLANE_SLACK(3); // a 32 bit load at the last texel of a plane.
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+/**
+ * @brief The Tap struct is the top left texel and the weights of a bilinear
+ * lookup. The coordinates are clamped before the lookup, which is the same
+ * as clamping the texels: x1 is outside the image only when wx is 0.
+ */
+struct Tap {
+	inline Tap(const Texture& tex, int u, int v) {
+		u = std::min(std::max(u, 0), int(tex.width - 1) << FRACTION_BITS);
+		v = std::min(std::max(v, 0), int(tex.height - 1) << FRACTION_BITS);
+		const int uq((u + TO_WEIGHT_ROUND) >> TO_WEIGHT_BITS);
+		const int vq((v + TO_WEIGHT_ROUND) >> TO_WEIGHT_BITS);
+		x = uq >> WEIGHT_BITS;
+		y = vq >> WEIGHT_BITS;
+		wx = uq & (WEIGHT_ONE - 1);
+		wy = vq & (WEIGHT_ONE - 1);
+	}
+
+	unsigned x, y;
+	unsigned wx, wy;
+};
+
+
+unsigned lerp(const unsigned a, const unsigned b, const unsigned w);
+
+unsigned load32(const byte* p);
+
+void sampleScalar(const Texture& tex, int u, int v,
+				  const int du, const int dv, const unsigned n, byte* out);
+
+void samplePlanarScalar(const Texture& tex, int u, int v,
+						const int du, const int dv, const unsigned n,
+						byte* out);
+
+#if SIMD_X86
+void sampleSSE2(const Texture& tex, int u, int v,
+				const int du, const int dv, const unsigned n, byte* out);
+
+void sampleAVX2(const Texture& tex, int u, int v,
+				const int du, const int dv, const unsigned n, byte* out);
+
+void samplePlanarSSE2(const Texture& tex, int u, int v,
+					  const int du, const int dv, const unsigned n, byte* out);
+
+void samplePlanarAVX2(const Texture& tex, int u, int v,
+					  const int du, const int dv, const unsigned n, byte* out);
+#elif SIMD_NEON
+void sampleNEON(const Texture& tex, int u, int v,
+				const int du, const int dv, const unsigned n, byte* out);
+#endif
+
+
+/* *****************************************************************************
+ * Sampler implementation.
+ * ****************************************************************************/
+Sampler::Sampler():
+	_layout(INTERLEAVED),
+	_level(SIMD_SCALAR),
+	_kernel(&sampleScalar)
+{
+	std::memset(&_tex, 0, sizeof(_tex));
+}
+
+
+Sampler::Sampler(const ConstImageView& img,
+				 const Layout layout,
+				 const SimdLevel level):
+	_layout(layout),
+	_level(SIMD_SCALAR),
+	_kernel(layout == PLANAR? &samplePlanarScalar : &sampleScalar)
+{
+	std::memset(&_tex, 0, sizeof(_tex));
+
+	if(img.null())
+		return;
+
+	_tex.bits = img.bits;
+	_tex.stride = img.stride;
+	_tex.width = img.width;
+	_tex.height = img.height;
+
+	if(layout == PLANAR)
+		split(img);
+
+#if SIMD_X86
+	if(level == SIMD_AVX2 or level == SIMD_SSE2) {
+		_level = level;
+
+		if(level == SIMD_AVX2)
+			_kernel = layout == PLANAR? &samplePlanarAVX2 : &sampleAVX2;
+		else
+			_kernel = layout == PLANAR? &samplePlanarSSE2 : &sampleSSE2;
+	}
+#elif SIMD_NEON
+	if(level == SIMD_NEON_LEVEL and layout == INTERLEAVED) {
+		_level = level;
+		_kernel = &sampleNEON;
+	}
+#endif
+}
+
+
+int Sampler::toFixed(const float f) {
+	return int(std::floor(f * ONE + 0.5f));
+}
+
+
+void Sampler::span(const int u,
+				   const int v,
+				   const int du,
+				   const int dv,
+				   const unsigned n,
+				   byte* const out) const
+{
+	assert(not null());
+	_kernel(_tex, u, v, du, dv, n, out);
+}
+
+
+/**
+ * Each plane has one extra column and row repeating the last ones, so the
+ * four texels of a lookup are always inside the plane.
+ */
+void Sampler::split(const ConstImageView& img) {
+	const unsigned w(img.width), h(img.height);
+	const unsigned stride(w + 1);
+	const unsigned size(stride * (h + 1));
+
+	_planes.reset(new std::vector<byte>(size * CHANNELS + PLANE_SLACK));
+
+	for(unsigned c(0); c != CHANNELS; ++c) {
+		byte* const plane(&_planes->front() + c * size);
+		_tex.planes[c] = plane;
+
+		for(unsigned y(0); y <= h; ++y) {
+			const byte* in(img.row(std::min(y, h - 1)) + c);
+			byte* const out(plane + y * stride);
+
+			for(unsigned x(0); x != w; ++x, in += CHANNELS)
+				out[x] = *in;
+
+			out[w] = out[w - 1];
+		}
+	}
+
+	_tex.plane_stride = stride;
+}
+
+
+/* *****************************************************************************
+ * Scalar kernels.
+ * The weights are applied in two steps, first horizontally and then
+ * vertically, rounding each time. This is what the vector versions can do in
+ * 16 bits, the scalar ones do the same to return exactly the same colors.
+ * ****************************************************************************/
+void sampleScalar(const Texture& tex, int u, int v,
+				  const int du, const int dv, const unsigned n, byte* out)
+{
+	for(unsigned i(0); i != n; ++i, u += du, v += dv, out += CHANNELS) {
+		const Tap tap(tex, u, v);
+		const byte* const p00(tex.bits + tap.y * tex.stride + tap.x * CHANNELS);
+		const byte* const p10(p00 + (tap.x + 1 < tex.width? CHANNELS : 0));
+		const unsigned dy(tap.y + 1 < tex.height? tex.stride : 0);
+		const byte* const p01(p00 + dy);
+		const byte* const p11(p10 + dy);
+
+		for(unsigned c(0); c != CHANNELS; ++c)
+			out[c] = lerp(lerp(p00[c], p10[c], tap.wx),
+						  lerp(p01[c], p11[c], tap.wx), tap.wy);
+	}
+}
+
+
+void samplePlanarScalar(const Texture& tex, int u, int v,
+						const int du, const int dv, const unsigned n,
+						byte* out)
+{
+	const unsigned stride(tex.plane_stride);
+
+	for(unsigned i(0); i != n; ++i, u += du, v += dv, out += CHANNELS) {
+		const Tap tap(tex, u, v);
+		const unsigned offset(tap.y * stride + tap.x);
+
+		for(unsigned c(0); c != CHANNELS; ++c) {
+			const byte* const p(tex.planes[c] + offset);
+			out[c] = lerp(lerp(p[0], p[1], tap.wx),
+						  lerp(p[stride], p[stride + 1], tap.wx), tap.wy);
+		}
+	}
+}
+
+
+#if SIMD_X86
+/* *****************************************************************************
+ * x86 kernels.
+ * ****************************************************************************/
+/**
+ * @brief lerp4 filters 4 RGBA pixels 'a' and 'b' with the weights 'w' of
+ * each pixel, in the lower 8 bits of each 32 bit lane.
+ */
+SIMD_TARGET("sse2")
+inline __m128i lerp4(const __m128i a, const __m128i b, const __m128i w) {
+	const __m128i zero(_mm_setzero_si128());
+	const __m128i one(_mm_set1_epi16(WEIGHT_ONE));
+	const __m128i round(_mm_set1_epi16(WEIGHT_ROUND));
+
+	const __m128i w16(_mm_or_si128(w, _mm_slli_epi32(w, 16)));
+	const __m128i wlo(_mm_unpacklo_epi32(w16, w16));
+	const __m128i whi(_mm_unpackhi_epi32(w16, w16));
+
+	const __m128i lo(_mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(one, wlo)),
+		_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wlo)));
+	const __m128i hi(_mm_add_epi16(
+		_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(one, whi)),
+		_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), whi)));
+
+	return _mm_packus_epi16(_mm_srli_epi16(_mm_add_epi16(lo, round), 8),
+							_mm_srli_epi16(_mm_add_epi16(hi, round), 8));
+}
+
+
+/// same as lerp4 for 8 pixels.
+SIMD_TARGET("avx2")
+inline __m256i lerp8(const __m256i a, const __m256i b, const __m256i w) {
+	const __m256i zero(_mm256_setzero_si256());
+	const __m256i one(_mm256_set1_epi16(WEIGHT_ONE));
+	const __m256i round(_mm256_set1_epi16(WEIGHT_ROUND));
+
+	const __m256i w16(_mm256_or_si256(w, _mm256_slli_epi32(w, 16)));
+	const __m256i wlo(_mm256_unpacklo_epi32(w16, w16));
+	const __m256i whi(_mm256_unpackhi_epi32(w16, w16));
+
+	const __m256i lo(_mm256_add_epi16(
+		_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero),
+						   _mm256_sub_epi16(one, wlo)),
+		_mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), wlo)));
+	const __m256i hi(_mm256_add_epi16(
+		_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero),
+						   _mm256_sub_epi16(one, whi)),
+		_mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), whi)));
+
+	// unpack and pack work inside each 128 bit half, so the order is kept.
+	return _mm256_packus_epi16(
+		_mm256_srli_epi16(_mm256_add_epi16(lo, round), 8),
+		_mm256_srli_epi16(_mm256_add_epi16(hi, round), 8));
+}
+
+
+/**
+ * @brief filterPairs filters one channel of 8 lookups where each 32 bit lane
+ * holds the horizontal neighbours (a, b) as 16 bit values, and 'w' holds
+ * the weights as (1 - w, w). The result is in the lower 8 bits of each lane.
+ */
+SIMD_TARGET("avx2")
+inline __m256i filterPairs8(const __m256i ab, const __m256i w) {
+	const __m256i round(_mm256_set1_epi32(WEIGHT_ROUND));
+	return _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(ab, w), round),
+							 WEIGHT_BITS);
+}
+
+
+SIMD_TARGET("sse2")
+inline __m128i filterPairs4(const __m128i ab, const __m128i w) {
+	const __m128i round(_mm_set1_epi32(WEIGHT_ROUND));
+	return _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(ab, w), round),
+						  WEIGHT_BITS);
+}
+
+
+/**
+ * @brief store4 writes the first 'n' pixels of 'rgba', all 4 if n >= 4.
+ * The lanes past the end of a span are computed with clamped, and so
+ * valid, coordinates and just not stored.
+ */
+SIMD_TARGET("sse2")
+inline void store4(const __m128i rgba, const unsigned n, byte* const out) {
+	if(n >= 4) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), rgba);
+		return;
+	}
+
+	byte last[4 * CHANNELS];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(last), rgba);
+	std::copy(last, last + n * CHANNELS, out);
+}
+
+
+/// same as store4 for 8 pixels.
+SIMD_TARGET("avx2")
+inline void store8(const __m256i rgba, const unsigned n, byte* const out) {
+	if(n >= 8) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), rgba);
+		return;
+	}
+
+	const __m256i lane(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256i mask(_mm256_cmpgt_epi32(_mm256_set1_epi32(n), lane));
+	_mm256_maskstore_epi32(reinterpret_cast<int*>(out), mask, rgba);
+}
+
+
+SIMD_TARGET("sse2")
+void sampleSSE2(const Texture& tex, int u, int v,
+				const int du, const int dv, const unsigned n, byte* out)
+{
+	const unsigned N(4);
+
+	for(unsigned i(0); i < n; i += N, out += N * CHANNELS) {
+		unsigned p[4][N], w[2][N];
+
+		for(unsigned j(0); j != N; ++j, u += du, v += dv) {
+			const Tap tap(tex, u, v);
+			const byte* const p00(tex.bits + tap.y * tex.stride +
+								  tap.x * CHANNELS);
+			const unsigned dx(tap.x + 1 < tex.width? CHANNELS : 0);
+			const unsigned dy(tap.y + 1 < tex.height? tex.stride : 0);
+
+			p[0][j] = load32(p00);
+			p[1][j] = load32(p00 + dx);
+			p[2][j] = load32(p00 + dy);
+			p[3][j] = load32(p00 + dy + dx);
+			w[0][j] = tap.wx;
+			w[1][j] = tap.wy;
+		}
+
+		const __m128i wx(_mm_loadu_si128(reinterpret_cast<__m128i*>(w[0])));
+		const __m128i wy(_mm_loadu_si128(reinterpret_cast<__m128i*>(w[1])));
+		const __m128i top(lerp4(
+			_mm_loadu_si128(reinterpret_cast<__m128i*>(p[0])),
+			_mm_loadu_si128(reinterpret_cast<__m128i*>(p[1])), wx));
+		const __m128i bottom(lerp4(
+			_mm_loadu_si128(reinterpret_cast<__m128i*>(p[2])),
+			_mm_loadu_si128(reinterpret_cast<__m128i*>(p[3])), wx));
+
+		store4(lerp4(top, bottom, wy), n - i, out);
+	}
+}
+
+
+SIMD_TARGET("avx2")
+void sampleAVX2(const Texture& tex, int u, int v,
+				const int du, const int dv, const unsigned n, byte* out)
+{
+	const unsigned N(8);
+	const int* const bits(reinterpret_cast<const int*>(tex.bits));
+	const __m256i lane(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256i lane_du(_mm256_mullo_epi32(lane, _mm256_set1_epi32(du)));
+	const __m256i lane_dv(_mm256_mullo_epi32(lane, _mm256_set1_epi32(dv)));
+	const __m256i zero(_mm256_setzero_si256());
+	const __m256i max_u(_mm256_set1_epi32((tex.width - 1) << FRACTION_BITS));
+	const __m256i max_v(_mm256_set1_epi32((tex.height - 1) << FRACTION_BITS));
+	const __m256i last_x(_mm256_set1_epi32(tex.width - 1));
+	const __m256i last_y(_mm256_set1_epi32(tex.height - 1));
+	const __m256i stride(_mm256_set1_epi32(tex.stride));
+	const __m256i channels(_mm256_set1_epi32(CHANNELS));
+	const __m256i round(_mm256_set1_epi32(TO_WEIGHT_ROUND));
+	const __m256i mask(_mm256_set1_epi32(WEIGHT_ONE - 1));
+
+	for(unsigned i(0); i < n;
+		i += N, u += N * du, v += N * dv, out += N * CHANNELS)
+	{
+		__m256i uu(_mm256_add_epi32(_mm256_set1_epi32(u), lane_du));
+		__m256i vv(_mm256_add_epi32(_mm256_set1_epi32(v), lane_dv));
+		uu = _mm256_min_epi32(_mm256_max_epi32(uu, zero), max_u);
+		vv = _mm256_min_epi32(_mm256_max_epi32(vv, zero), max_v);
+		uu = _mm256_srai_epi32(_mm256_add_epi32(uu, round), TO_WEIGHT_BITS);
+		vv = _mm256_srai_epi32(_mm256_add_epi32(vv, round), TO_WEIGHT_BITS);
+
+		const __m256i x(_mm256_srai_epi32(uu, WEIGHT_BITS));
+		const __m256i y(_mm256_srai_epi32(vv, WEIGHT_BITS));
+		const __m256i wx(_mm256_and_si256(uu, mask));
+		const __m256i wy(_mm256_and_si256(vv, mask));
+
+		// byte offsets of the four texels, the right and bottom neighbours
+		// are the texel itself at the edges so nothing is read outside.
+		const __m256i o00(_mm256_add_epi32(_mm256_mullo_epi32(y, stride),
+										   _mm256_slli_epi32(x, 2)));
+		const __m256i dx(_mm256_and_si256(_mm256_cmpgt_epi32(last_x, x),
+										  channels));
+		const __m256i dy(_mm256_and_si256(_mm256_cmpgt_epi32(last_y, y),
+										  stride));
+		const __m256i o10(_mm256_add_epi32(o00, dx));
+		const __m256i o01(_mm256_add_epi32(o00, dy));
+		const __m256i o11(_mm256_add_epi32(o10, dy));
+
+		const __m256i top(lerp8(_mm256_i32gather_epi32(bits, o00, 1),
+								_mm256_i32gather_epi32(bits, o10, 1), wx));
+		const __m256i bottom(lerp8(_mm256_i32gather_epi32(bits, o01, 1),
+								   _mm256_i32gather_epi32(bits, o11, 1), wx));
+
+		store8(lerp8(top, bottom, wy), n - i, out);
+	}
+}
+
+
+SIMD_TARGET("sse2")
+void samplePlanarSSE2(const Texture& tex, int u, int v,
+					  const int du, const int dv, const unsigned n, byte* out)
+{
+	const unsigned N(4);
+	const unsigned stride(tex.plane_stride);
+
+	for(unsigned i(0); i < n; i += N, out += N * CHANNELS) {
+		unsigned offset[N], wx[N], wy[N];
+
+		for(unsigned j(0); j != N; ++j, u += du, v += dv) {
+			const Tap tap(tex, u, v);
+			offset[j] = tap.y * stride + tap.x;
+			wx[j] = (WEIGHT_ONE - tap.wx) | (tap.wx << 16);
+			wy[j] = (WEIGHT_ONE - tap.wy) | (tap.wy << 16);
+		}
+
+		const __m128i wxs(_mm_loadu_si128(reinterpret_cast<__m128i*>(wx)));
+		const __m128i wys(_mm_loadu_si128(reinterpret_cast<__m128i*>(wy)));
+		__m128i rgba(_mm_setzero_si128());
+
+		for(unsigned c(0); c != CHANNELS; ++c) {
+			unsigned t[N], b[N];
+
+			for(unsigned j(0); j != N; ++j) {
+				const byte* const p(tex.planes[c] + offset[j]);
+				t[j] = p[0] | (p[1] << 16);
+				b[j] = p[stride] | (p[stride + 1] << 16);
+			}
+
+			const __m128i top(filterPairs4(
+				_mm_loadu_si128(reinterpret_cast<__m128i*>(t)), wxs));
+			const __m128i bottom(filterPairs4(
+				_mm_loadu_si128(reinterpret_cast<__m128i*>(b)), wxs));
+			const __m128i value(filterPairs4(
+				_mm_or_si128(top, _mm_slli_epi32(bottom, 16)), wys));
+
+			rgba = _mm_or_si128(rgba, _mm_slli_epi32(value, 8 * c));
+		}
+
+		store4(rgba, n - i, out);
+	}
+}
+
+
+/**
+ * Each plane is read with a 32 bit gather, which brings both horizontal
+ * neighbours of a row at once: 8 gathers for the 4 channels against the 16
+ * of the interleaved version.
+ */
+SIMD_TARGET("avx2")
+void samplePlanarAVX2(const Texture& tex, int u, int v,
+					  const int du, const int dv, const unsigned n, byte* out)
+{
+	const unsigned N(8);
+	const __m256i lane(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	const __m256i lane_du(_mm256_mullo_epi32(lane, _mm256_set1_epi32(du)));
+	const __m256i lane_dv(_mm256_mullo_epi32(lane, _mm256_set1_epi32(dv)));
+	const __m256i zero(_mm256_setzero_si256());
+	const __m256i max_u(_mm256_set1_epi32((tex.width - 1) << FRACTION_BITS));
+	const __m256i max_v(_mm256_set1_epi32((tex.height - 1) << FRACTION_BITS));
+	const __m256i stride(_mm256_set1_epi32(tex.plane_stride));
+	const __m256i round(_mm256_set1_epi32(TO_WEIGHT_ROUND));
+	const __m256i mask(_mm256_set1_epi32(WEIGHT_ONE - 1));
+	const __m256i one(_mm256_set1_epi32(WEIGHT_ONE));
+	const __m256i lo_byte(_mm256_set1_epi32(0x00ff));
+	const __m256i hi_byte(_mm256_set1_epi32(0xff00));
+
+	for(unsigned i(0); i < n;
+		i += N, u += N * du, v += N * dv, out += N * CHANNELS)
+	{
+		__m256i uu(_mm256_add_epi32(_mm256_set1_epi32(u), lane_du));
+		__m256i vv(_mm256_add_epi32(_mm256_set1_epi32(v), lane_dv));
+		uu = _mm256_min_epi32(_mm256_max_epi32(uu, zero), max_u);
+		vv = _mm256_min_epi32(_mm256_max_epi32(vv, zero), max_v);
+		uu = _mm256_srai_epi32(_mm256_add_epi32(uu, round), TO_WEIGHT_BITS);
+		vv = _mm256_srai_epi32(_mm256_add_epi32(vv, round), TO_WEIGHT_BITS);
+
+		const __m256i x(_mm256_srai_epi32(uu, WEIGHT_BITS));
+		const __m256i y(_mm256_srai_epi32(vv, WEIGHT_BITS));
+		const __m256i wx(_mm256_and_si256(uu, mask));
+		const __m256i wy(_mm256_and_si256(vv, mask));
+		const __m256i wxs(_mm256_or_si256(_mm256_sub_epi32(one, wx),
+										  _mm256_slli_epi32(wx, 16)));
+		const __m256i wys(_mm256_or_si256(_mm256_sub_epi32(one, wy),
+										  _mm256_slli_epi32(wy, 16)));
+
+		const __m256i o0(_mm256_add_epi32(_mm256_mullo_epi32(y, stride), x));
+		const __m256i o1(_mm256_add_epi32(o0, stride));
+		__m256i rgba(zero);
+
+		for(unsigned c(0); c != CHANNELS; ++c) {
+			const int* const plane(reinterpret_cast<const int*>(tex.planes[c]));
+			const __m256i t(_mm256_i32gather_epi32(plane, o0, 1));
+			const __m256i b(_mm256_i32gather_epi32(plane, o1, 1));
+
+			// bytes (a, b, -, -) to 16 bit pairs (a, b)
+			const __m256i tp(_mm256_or_si256(
+				_mm256_and_si256(t, lo_byte),
+				_mm256_slli_epi32(_mm256_and_si256(t, hi_byte), 8)));
+			const __m256i bp(_mm256_or_si256(
+				_mm256_and_si256(b, lo_byte),
+				_mm256_slli_epi32(_mm256_and_si256(b, hi_byte), 8)));
+
+			const __m256i top(filterPairs8(tp, wxs));
+			const __m256i bottom(filterPairs8(bp, wxs));
+			const __m256i value(filterPairs8(
+				_mm256_or_si256(top, _mm256_slli_epi32(bottom, 16)), wys));
+
+			rgba = _mm256_or_si256(rgba, _mm256_slli_epi32(value, 8 * c));
+		}
+
+		store8(rgba, n - i, out);
+	}
+}
+#endif // SIMD_X86
+
+
+#if SIMD_NEON
+/* *****************************************************************************
+ * NEON kernels.
+ * ****************************************************************************/
+/// lerp4 for NEON, 'wlo' and 'whi' have the weights of the lower and upper
+/// 2 pixels, one per channel.
+inline uint8x16_t lerp4(const uint8x16_t a, const uint8x16_t b,
+						const uint16x8_t wlo, const uint16x8_t whi)
+{
+	const uint16x8_t one(vdupq_n_u16(WEIGHT_ONE));
+	const uint16x8_t lo(vmlaq_u16(
+		vmulq_u16(vmovl_u8(vget_low_u8(a)), vsubq_u16(one, wlo)),
+		vmovl_u8(vget_low_u8(b)), wlo));
+	const uint16x8_t hi(vmlaq_u16(
+		vmulq_u16(vmovl_u8(vget_high_u8(a)), vsubq_u16(one, whi)),
+		vmovl_u8(vget_high_u8(b)), whi));
+
+	// vrshrq adds the rounding without overflowing
+	return vcombine_u8(vmovn_u16(vrshrq_n_u16(lo, WEIGHT_BITS)),
+					   vmovn_u16(vrshrq_n_u16(hi, WEIGHT_BITS)));
+}
+
+
+void sampleNEON(const Texture& tex, int u, int v,
+				const int du, const int dv, const unsigned n, byte* out)
+{
+	const unsigned N(4);
+
+	for(unsigned i(0); i < n; i += N, out += N * CHANNELS) {
+		uint32_t p[4][N];
+		uint16_t wx[N * CHANNELS], wy[N * CHANNELS];
+
+		for(unsigned j(0); j != N; ++j, u += du, v += dv) {
+			const Tap tap(tex, u, v);
+			const byte* const p00(tex.bits + tap.y * tex.stride +
+								  tap.x * CHANNELS);
+			const unsigned dx(tap.x + 1 < tex.width? CHANNELS : 0);
+			const unsigned dy(tap.y + 1 < tex.height? tex.stride : 0);
+
+			p[0][j] = load32(p00);
+			p[1][j] = load32(p00 + dx);
+			p[2][j] = load32(p00 + dy);
+			p[3][j] = load32(p00 + dy + dx);
+			std::fill(wx + j * CHANNELS, wx + (j + 1) * CHANNELS, tap.wx);
+			std::fill(wy + j * CHANNELS, wy + (j + 1) * CHANNELS, tap.wy);
+		}
+
+		const uint16x8_t wxl(vld1q_u16(wx)), wxh(vld1q_u16(wx + 8));
+		const uint8x16_t top(lerp4(vreinterpretq_u8_u32(vld1q_u32(p[0])),
+								   vreinterpretq_u8_u32(vld1q_u32(p[1])),
+								   wxl, wxh));
+		const uint8x16_t bottom(lerp4(vreinterpretq_u8_u32(vld1q_u32(p[2])),
+									  vreinterpretq_u8_u32(vld1q_u32(p[3])),
+									  wxl, wxh));
+		const uint8x16_t rgba(lerp4(top, bottom,
+									vld1q_u16(wy), vld1q_u16(wy + 8)));
+
+		if(n - i >= N)
+			vst1q_u8(out, rgba);
+		else {
+			byte last[N * CHANNELS];
+			vst1q_u8(last, rgba);
+			std::copy(last, last + (n - i) * CHANNELS, out);
+		}
+	}
+}
+#endif // SIMD_NEON
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+unsigned lerp(const unsigned a, const unsigned b, const unsigned w) {
+	return (a * (WEIGHT_ONE - w) + b * w + WEIGHT_ROUND) >> WEIGHT_BITS;
+}
+
+
+unsigned load32(const byte* const p) {
+	unsigned v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
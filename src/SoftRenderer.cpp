@@ -0,0 +1,427 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "SoftRenderer.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+
+typedef SoftRenderer::byte byte;
+
+const float SUBPIXEL(1.0f / Rasterizer::SUBPIXEL_ONE);
+const unsigned ALPHA_ONE(255);
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void blend(const byte* src, const byte* dst, const unsigned alpha,
+		   const unsigned n, byte* out);
+
+
+/**
+ * @brief The Plane struct is the linear equation a*x + b*y + c of one vertex
+ * attribute over the triangle, in pixels.
+ */
+struct Plane {
+	Plane(): a(0.0f), b(0.0f), c(0.0f) {}
+
+	Plane(const float x0, const float y0, const float v0,
+		  const float x1, const float y1, const float v1,
+		  const float x2, const float y2, const float v2)
+	{
+		const float area((x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0));
+		assert(area != 0.0f);
+		a = ((v1 - v0) * (y2 - y0) - (v2 - v0) * (y1 - y0)) / area;
+		b = ((x1 - x0) * (v2 - v0) - (x2 - x0) * (v1 - v0)) / area;
+		c = v0 - a * x0 - b * y0;
+	}
+
+	inline float operator()(const float x, const float y) const {
+		return a * x + b * y + c;
+	}
+
+	float a, b, c;
+};
+
+
+/**
+ * @brief The Layer struct is a texture mapped over the current triangle.
+ * Texture coordinates are affine so they are stepped in fixed point from
+ * column 'x' of the triangle, the same for every span whatever tile
+ * it was cut to.
+ */
+struct Layer {
+	Layer(): tex(0), x(0), du(0), dv(0) {}
+
+	void setup(const Sampler& sampler, const int left,
+			   const float ax, const float ay, const vec2& ta,
+			   const float bx, const float by, const vec2& tb,
+			   const float cx, const float cy, const vec2& tc)
+	{
+		tex = &sampler;
+		x = left;
+		u = Plane(ax, ay, ta.x, bx, by, tb.x, cx, cy, tc.x);
+		v = Plane(ax, ay, ta.y, bx, by, tb.y, cx, cy, tc.y);
+		du = Sampler::toFixed(u.a);
+		dv = Sampler::toFixed(v.a);
+	}
+
+	inline void span(const Rasterizer::Span& span, byte* const out) const {
+		const float cx(x + 0.5f), cy(span.y + 0.5f);
+		const int skip(span.x0 - x);
+		const int u0(Sampler::toFixed(u(cx, cy)) + skip * du);
+		const int v0(Sampler::toFixed(v(cx, cy)) + skip * dv);
+		tex->span(u0, v0, du, dv, span.x1 - span.x0, out);
+	}
+
+	const Sampler* tex;
+	int x;
+	Plane u, v;
+	int du, dv;
+};
+
+
+/**
+ * @brief The Shader struct writes the cross dissolve of the src and dst
+ * layers over a span, each pixel of the target is written once.
+ * A missing src layer blends dst over what is already on the target,
+ * a missing dst layer copies src.
+ */
+struct Shader {
+	Shader(const Layer& src,
+		   const Layer& dst,
+		   const unsigned alpha,
+		   const ImageView& target,
+		   std::vector<byte>& src_row,
+		   std::vector<byte>& dst_row):
+		src(src),
+		dst(dst),
+		alpha(alpha),
+		target(target),
+		src_row(src_row),
+		dst_row(dst_row)
+	{}
+
+	void operator()(const Rasterizer::Span& span) {
+		const unsigned n(span.x1 - span.x0);
+		byte* const out(target.pixel(span.x0, span.y));
+
+		if(dst.tex == 0) {
+			src.span(span, out);
+			return;
+		}
+
+		if(alpha == ALPHA_ONE) {
+			dst.span(span, out);
+			return;
+		}
+
+		dst_row.resize(n * 4);
+		dst.span(span, &dst_row.front());
+
+		if(src.tex == 0) {
+			blend(out, &dst_row.front(), alpha, n, out);
+			return;
+		}
+
+		src_row.resize(n * 4);
+		src.span(span, &src_row.front());
+		blend(&src_row.front(), &dst_row.front(), alpha, n, out);
+	}
+
+	const Layer& src;
+	const Layer& dst;
+	const unsigned alpha;
+	const ImageView& target;
+	std::vector<byte>& src_row;
+	std::vector<byte>& dst_row;
+};
+
+
+/**
+ * @brief The Job struct is what every tile of a frame needs, the samplers
+ * are null when not drawn.
+ */
+struct SoftRenderer::Job {
+	Job(const Faces& faces,
+		const Sampler* src,
+		const Sampler* dst,
+		const unsigned alpha,
+		const ImageView& target):
+		faces(faces),
+		src(src),
+		dst(dst),
+		alpha(alpha),
+		target(target)
+	{}
+
+	const Faces& faces;
+	const Sampler* src;
+	const Sampler* dst;
+	const unsigned alpha;
+	const ImageView& target;
+};
+
+
+/* *****************************************************************************
+ * SoftRenderer implementation.
+ * ****************************************************************************/
+SoftRenderer::SoftRenderer(const SimdLevel level):
+	_level(level),
+	_rasterizer(level),
+	_pool(0),
+	_tiles_x(0)
+{}
+
+
+void SoftRenderer::setThreadPool(ThreadPool* const pool) {
+	_pool = pool;
+}
+
+
+void SoftRenderer::clear(const ImageView& target, const color& c) const {
+	if(target.null())
+		return;
+
+	const color& cc(cgl::clamp(c, 0.0f, 1.0f));
+	const byte px[4] = {
+		byte(cc.r * 255.0f + 0.5f), byte(cc.g * 255.0f + 0.5f),
+		byte(cc.b * 255.0f + 0.5f), byte(cc.a * 255.0f + 0.5f)
+	};
+
+	for(unsigned y(0); y != target.height; ++y) {
+		byte* const row(target.row(y));
+		byte* const end(row + target.width * 4);
+
+		for(byte* i(row); i != end; i += 4)
+			std::copy(px, px + 4, i);
+	}
+}
+
+
+void SoftRenderer::drawBlended(const Mesh& src_mesh,
+							   const Mesh& dst_mesh,
+							   const Faces& faces,
+							   const ConstImageView& src_img,
+							   const ConstImageView& dst_img,
+							   const float t,
+							   const ImageView& target)
+{
+	drawBlended(src_mesh, dst_mesh, faces,
+				Sampler(src_img, Sampler::INTERLEAVED, _level),
+				Sampler(dst_img, Sampler::INTERLEAVED, _level),
+				t, target);
+}
+
+
+void SoftRenderer::drawBlended(const Mesh& src_mesh,
+							   const Mesh& dst_mesh,
+							   const Faces& faces,
+							   const Sampler& src,
+							   const Sampler& dst,
+							   const float t,
+							   const ImageView& target)
+{
+	assert(src_mesh.size() == dst_mesh.size());
+
+	if(target.null() or faces.empty())
+		return;
+
+	const unsigned alpha(t * ALPHA_ONE + 0.5f);
+	// at t = 1 dst covers src, unless there is no dst to draw
+	const bool use_dst(not dst.null() and alpha != 0);
+	const bool use_src(not src.null() and
+					   (alpha != ALPHA_ONE or not use_dst));
+
+	if(not use_src and not use_dst)
+		return;
+
+	interpolate(src_mesh, dst_mesh, t, _mesh);
+	transform(_mesh, target);
+
+	if(use_src)
+		texels(src_mesh, src, _src_texels);
+
+	if(use_dst)
+		texels(dst_mesh, dst, _dst_texels);
+
+	bin(faces, target);
+
+	const Job job(faces, use_src? &src : 0, use_dst? &dst : 0, alpha, target);
+	const unsigned tiles(_tiles.size());
+
+	if(_pool == 0) {
+		_scratch.resize(1);
+
+		for(unsigned i(0); i != tiles; ++i)
+			renderTile(job, i, 0);
+		return;
+	}
+
+	using std::placeholders::_1;
+	using std::placeholders::_2;
+	_scratch.resize(_pool->size());
+	_pool->parallelFor(tiles, std::bind(&SoftRenderer::renderTile, this,
+										std::cref(job), _1, _2));
+}
+
+
+/**
+ * The meshes are in [0, 1] with y pointing up, as used by the GL path.
+ * The images are stored top to bottom, as is the GL read back and
+ * the textures created by QGLWidget::bindTexture (that flips y on upload),
+ * so both positions and texture coordinates have y inverted.
+ */
+void SoftRenderer::transform(const Mesh& mesh, const ImageView& target) {
+	const unsigned N(mesh.size());
+	const float w(target.width), h(target.height);
+
+	_points.resize(N);
+
+	for(unsigned i(0); i != N; ++i) {
+		_points[i].x = Rasterizer::toFixed(mesh[i].x * w);
+		_points[i].y = Rasterizer::toFixed((1.0f - mesh[i].y) * h);
+	}
+}
+
+
+void SoftRenderer::texels(const Mesh& tc, const Sampler& tex, Mesh& out) {
+	const unsigned N(tc.size());
+	const float tw(tex.width()), th(tex.height());
+
+	out.resize(N);
+
+	// texel centers are at +0.5
+	for(unsigned i(0); i != N; ++i)
+		out[i] = vec2(tc[i].x * tw - 0.5f, (1.0f - tc[i].y) * th - 0.5f);
+}
+
+
+void SoftRenderer::bin(const Faces& faces, const ImageView& target) {
+	const int w(target.width), h(target.height);
+	const int T(TILE_SIZE);
+	const unsigned tiles_y((h + T - 1) / T);
+	_tiles_x = (w + T - 1) / T;
+	_tiles.resize(_tiles_x * tiles_y);
+
+	for(unsigned i(0); i != _tiles.size(); ++i)
+		_tiles[i].clear();
+
+	for(unsigned i(0); i != faces.size(); ++i) {
+		const Rasterizer::Point& a(_points[faces[i].a]);
+		const Rasterizer::Point& b(_points[faces[i].b]);
+		const Rasterizer::Point& c(_points[faces[i].c]);
+
+		// the pixels whose centers the face may cover
+		const int bits(Rasterizer::SUBPIXEL_BITS);
+		const int x0(std::min(std::min(a.x, b.x), c.x) >> bits);
+		const int y0(std::min(std::min(a.y, b.y), c.y) >> bits);
+		const int x1(std::max(std::max(a.x, b.x), c.x) >> bits);
+		const int y1(std::max(std::max(a.y, b.y), c.y) >> bits);
+
+		if(x1 < 0 or y1 < 0 or x0 >= w or y0 >= h)
+			continue;
+
+		const int tx0(std::max(x0, 0) / T), tx1(std::min(x1, w - 1) / T);
+		const int ty0(std::max(y0, 0) / T), ty1(std::min(y1, h - 1) / T);
+
+		for(int ty(ty0); ty <= ty1; ++ty)
+			for(int tx(tx0); tx <= tx1; ++tx)
+				_tiles[ty * _tiles_x + tx].push_back(i);
+	}
+}
+
+
+void SoftRenderer::renderTile(const Job& job,
+							  const unsigned tile,
+							  const unsigned worker)
+{
+	const Bin& faces(_tiles[tile]);
+	Scratch& scratch(_scratch[worker]);
+	const int T(TILE_SIZE);
+	const int x0((tile % _tiles_x) * T), y0((tile / _tiles_x) * T);
+	const int x1(std::min(x0 + T, int(job.target.width)));
+	const int y1(std::min(y0 + T, int(job.target.height)));
+
+	Layer src, dst;
+	Shader shader(src, dst, job.alpha, job.target,
+				  scratch.src_row, scratch.dst_row);
+
+	for(unsigned i(0); i != faces.size(); ++i) {
+		const Trig& f(job.faces[faces[i]]);
+		const Rasterizer::Point& a(_points[f.a]);
+		const Rasterizer::Point& b(_points[f.b]);
+		const Rasterizer::Point& c(_points[f.c]);
+
+		scratch.spans.clear();
+
+		if(_rasterizer.triangle(a, b, c, x0, y0, x1, y1, scratch.spans) == 0)
+			continue;
+
+		const float ax(a.x * SUBPIXEL), ay(a.y * SUBPIXEL);
+		const float bx(b.x * SUBPIXEL), by(b.y * SUBPIXEL);
+		const float cx(c.x * SUBPIXEL), cy(c.y * SUBPIXEL);
+		const int left(std::max(0, std::min(std::min(a.x, b.x), c.x) >>
+									   Rasterizer::SUBPIXEL_BITS));
+
+		if(job.src != 0)
+			src.setup(*job.src, left,
+					  ax, ay, _src_texels[f.a],
+					  bx, by, _src_texels[f.b],
+					  cx, cy, _src_texels[f.c]);
+
+		if(job.dst != 0)
+			dst.setup(*job.dst, left,
+					  ax, ay, _dst_texels[f.a],
+					  bx, by, _dst_texels[f.b],
+					  cx, cy, _dst_texels[f.c]);
+
+		std::for_each(scratch.spans.begin(), scratch.spans.end(), shader);
+	}
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/**
+ * @brief blend the cross dissolve of 'n' 'src' and 'dst' pixels to 'out',
+ * as drawing src then dst with glBlendFunc(GL_CONSTANT_ALPHA,
+ * GL_ONE_MINUS_CONSTANT_ALPHA) does. 'out' may be 'src'.
+ * (x + 127) / 255 is computed with shifts, exact for any x <= 255 * 255.
+ */
+void blend(const byte* const src, const byte* const dst, const unsigned alpha,
+		   const unsigned n, byte* const out)
+{
+	assert(alpha <= ALPHA_ONE);
+
+	for(unsigned i(0); i != n * 4; ++i) {
+		const unsigned x(src[i] * (ALPHA_ONE - alpha) + dst[i] * alpha + 128);
+		out[i] = (x + (x >> 8)) >> 8;
+	}
+}
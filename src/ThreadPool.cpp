@@ -0,0 +1,255 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+typedef std::lock_guard<std::mutex> Lock;
+typedef std::unique_lock<std::mutex> UniqueLock;
+
+
+/**
+ * @brief The Slice struct is the items [begin, end) left to a worker.
+ * The owner takes them from the front, thieves from the back.
+ */
+struct Slice {
+	Slice(): begin(0), end(0) {}
+
+	std::mutex mutex;
+	unsigned begin, end;
+};
+
+
+struct ThreadPool::PImpl {
+	PImpl(const unsigned size);
+
+	~PImpl();
+
+	void loop(const unsigned worker);
+
+	void work(const unsigned worker);
+
+	bool next(const unsigned worker, unsigned& index);
+
+	bool steal(const unsigned worker);
+
+
+	const unsigned size;
+	std::unique_ptr<Slice[]> slices;
+	std::vector<std::thread> threads;
+
+	std::mutex run; // one parallelFor at a time
+	std::mutex mutex; // everything below
+	std::condition_variable wake;
+	std::condition_variable done;
+	const Body* body;
+	std::atomic<unsigned> remaining;
+	unsigned generation;
+	unsigned active; // workers inside work()
+	bool stop;
+};
+
+
+/* *****************************************************************************
+ * ThreadPool implementation.
+ * ****************************************************************************/
+ThreadPool::ThreadPool(const unsigned size)
+	: _pimpl(new PImpl(size != 0? size :
+					   std::max(1u, std::thread::hardware_concurrency())))
+{}
+
+
+ThreadPool::~ThreadPool() {}
+
+
+void ThreadPool::parallelFor(const unsigned count, const Body& body) {
+	PImpl& p(*_pimpl);
+
+	if(count == 0)
+		return;
+
+	if(p.size == 1 or count == 1) {
+		for(unsigned i(0); i != count; ++i)
+			body(i, 0);
+		return;
+	}
+
+	const Lock run(p.run);
+	p.body = &body;
+	p.remaining = count;
+
+	for(unsigned i(0); i != p.size; ++i) {
+		const Lock lock(p.slices[i].mutex);
+		p.slices[i].begin = unsigned(uint64_t(count) * i / p.size);
+		p.slices[i].end = unsigned(uint64_t(count) * (i + 1) / p.size);
+	}
+
+	{
+		const Lock lock(p.mutex);
+		++p.generation;
+	}
+
+	p.wake.notify_all();
+
+	// the last slice is the caller's
+	p.work(p.size - 1);
+
+	UniqueLock lock(p.mutex);
+
+	while(p.remaining != 0 or p.active != 0)
+		p.done.wait(lock);
+
+	p.body = 0;
+}
+
+
+unsigned ThreadPool::size() const {
+	return _pimpl->size;
+}
+
+
+/* *****************************************************************************
+ * PImpl implementation.
+ * ****************************************************************************/
+ThreadPool::PImpl::PImpl(const unsigned size)
+	: size(size)
+	, slices(new Slice[size])
+	, body(0)
+	, remaining(0)
+	, generation(0)
+	, active(0)
+	, stop(false)
+{
+	for(unsigned i(0); i + 1 < size; ++i)
+		threads.push_back(std::thread(&PImpl::loop, this, i));
+}
+
+
+ThreadPool::PImpl::~PImpl() {
+	{
+		const Lock lock(mutex);
+		stop = true;
+	}
+
+	wake.notify_all();
+
+	for(unsigned i(0); i != threads.size(); ++i)
+		threads[i].join();
+}
+
+
+void ThreadPool::PImpl::loop(const unsigned worker) {
+	unsigned seen(0);
+
+	for(;;) {
+		{
+			UniqueLock lock(mutex);
+
+			while(not stop and generation == seen)
+				wake.wait(lock);
+
+			if(stop)
+				return;
+
+			seen = generation;
+			++active;
+		}
+
+		work(worker);
+
+		const Lock lock(mutex);
+
+		if(--active == 0 and remaining == 0)
+			done.notify_all();
+	}
+}
+
+
+void ThreadPool::PImpl::work(const unsigned worker) {
+	unsigned index;
+
+	for(;;) {
+		if(not next(worker, index)) {
+			if(steal(worker))
+				continue;
+			return;
+		}
+
+		(*body)(index, worker);
+
+		if(remaining.fetch_sub(1) == 1) {
+			const Lock lock(mutex);
+			done.notify_all();
+		}
+	}
+}
+
+
+bool ThreadPool::PImpl::next(const unsigned worker, unsigned& index) {
+	Slice& slice(slices[worker]);
+	const Lock lock(slice.mutex);
+
+	if(slice.begin == slice.end)
+		return false;
+
+	index = slice.begin++;
+	return true;
+}
+
+
+bool ThreadPool::PImpl::steal(const unsigned worker) {
+	for(unsigned i(1); i != size; ++i) {
+		Slice& victim(slices[(worker + i) % size]);
+		unsigned begin, end;
+
+		{
+			const Lock lock(victim.mutex);
+			const unsigned left(victim.end - victim.begin);
+
+			if(left == 0)
+				continue;
+
+			end = victim.end;
+			begin = end - (left + 1) / 2;
+			victim.end = begin;
+		}
+
+		Slice& own(slices[worker]);
+		const Lock lock(own.mutex);
+		assert(own.begin == own.end);
+		own.begin = begin;
+		own.end = end;
+		return true;
+	}
+
+	return false;
+}
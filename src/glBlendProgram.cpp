@@ -0,0 +1,282 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "glBlendProgram.hpp"
+
+#include <QGLContext>
+#include <algorithm>
+#include <cassert>
+
+
+/// GLSL 1.20 keeps the fixed function matrices, set by cgl::view2D()
+const char* const VERTEX_SHADER(
+	"#version 120\n"
+	"attribute vec2 src;\n"
+	"attribute vec2 dst;\n"
+	"uniform float t;\n"
+	"varying vec2 src_tc;\n"
+	"varying vec2 dst_tc;\n"
+	"void main() {\n"
+	"	src_tc = src;\n"
+	"	dst_tc = dst;\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix *\n"
+	"		vec4(mix(src, dst, t), 0.0, 1.0);\n"
+	"}\n");
+
+/// a missing image is replaced by the background, a missing dst by weight 0
+const char* const FRAGMENT_SHADER(
+	"#version 120\n"
+	"uniform sampler2D src_tex;\n"
+	"uniform sampler2D dst_tex;\n"
+	"uniform vec4 background;\n"
+	"uniform float has_src;\n"
+	"uniform float weight;\n"
+	"varying vec2 src_tc;\n"
+	"varying vec2 dst_tc;\n"
+	"void main() {\n"
+	"	vec4 src = mix(background, texture2D(src_tex, src_tc), has_src);\n"
+	"	gl_FragColor = mix(src, texture2D(dst_tex, dst_tc), weight);\n"
+	"}\n");
+
+
+/* ************************************************************************** *
+ * Utilities forward declaration
+ * ************************************************************************** */
+
+/// @brief upload writes 'bytes' to 'buffer', allocating it if they do not fit
+void upload(QGLBuffer& buffer, const void* const data, const int bytes);
+
+/// @brief same tells whether 'a' and 'b' are exactly equal
+bool same(const vec2& a, const vec2& b);
+
+/// @brief resolve the entry point 'name' of 'context', null if there is none
+template<typename F>
+F resolve(const QGLContext* const context, const char* const name);
+
+
+/* ************************************************************************** *
+ * glBlendProgram implementation
+ * ************************************************************************** */
+
+glBlendProgram::glBlendProgram():
+	_indices(QGLBuffer::IndexBuffer),
+	_faces_revision(NONE),
+	_index_count(0),
+	_index_span(0),
+	_t(-1),
+	_has_src(-1),
+	_weight(-1),
+	_active_texture(0)
+{
+	for(unsigned i(0); i != SOURCES; ++i) {
+		_revisions[i] = NONE;
+		_vertex_count[i] = 0;
+		_attributes[i] = -1;
+	}
+}
+
+
+glBlendProgram::~glBlendProgram() {}
+
+
+bool glBlendProgram::init(const QGLContext* const context) {
+	assert(context == QGLContext::currentContext());
+
+	_active_texture = resolve<PFNGLACTIVETEXTUREPROC>(context,
+													  "glActiveTexture");
+
+	if(_active_texture == 0 or
+	   not QGLShaderProgram::hasOpenGLShaderPrograms(context))
+		return false;
+
+	if(not _program.addShaderFromSourceCode(QGLShader::Vertex,
+											VERTEX_SHADER) or
+	   not _program.addShaderFromSourceCode(QGLShader::Fragment,
+											FRAGMENT_SHADER) or
+	   not _program.link())
+		return false;
+
+	_attributes[SRC] = _program.attributeLocation("src");
+	_attributes[DST] = _program.attributeLocation("dst");
+	_t = _program.uniformLocation("t");
+	_has_src = _program.uniformLocation("has_src");
+	_weight = _program.uniformLocation("weight");
+
+	_program.bind();
+	_program.setUniformValue("src_tex", GLint(SRC)); // texture units
+	_program.setUniformValue("dst_tex", GLint(DST));
+	_program.release();
+
+	// the meshes change while dragging, the faces only with the resolution
+	for(unsigned i(0); i != SOURCES; ++i) {
+		_vertices[i].setUsagePattern(QGLBuffer::DynamicDraw);
+		_uploaded[i].clear(); // a new buffer holds nothing yet
+		_revisions[i] = NONE;
+
+		if(not _vertices[i].create())
+			return false;
+	}
+
+	_indices.setUsagePattern(QGLBuffer::StaticDraw);
+	return _indices.create();
+}
+
+
+void glBlendProgram::mesh(const Source source,
+						  const Mesh& msh,
+						  const unsigned revision)
+{
+	assert(source == SRC or source == DST);
+
+	if(revision == _revisions[source])
+		return;
+
+	QGLBuffer& buffer(_vertices[source]);
+	Mesh& uploaded(_uploaded[source]);
+	const unsigned N(msh.size());
+
+	_vertex_count[source] = N;
+	_revisions[source] = revision;
+
+	// 'uploaded' mirrors the buffer, its size needs no bound buffer query
+	if(uploaded.size() != N) {
+		upload(buffer, msh.data(), N * sizeof(vec2));
+		uploaded = msh;
+		return;
+	}
+
+	// the span from the first to the last vertex moved since the upload
+	unsigned first(0);
+	while(first != N and same(msh[first], uploaded[first]))
+		++first;
+
+	if(first == N)
+		return;
+
+	unsigned last(N);
+	while(same(msh[last - 1], uploaded[last - 1]))
+		--last;
+
+	buffer.bind();
+	buffer.write(first * sizeof(vec2), &msh[first],
+				 (last - first) * sizeof(vec2));
+	buffer.release();
+
+	std::copy(msh.begin() + first, msh.begin() + last,
+			  uploaded.begin() + first);
+}
+
+
+void glBlendProgram::faces(const Faces& fcs, const unsigned revision) {
+	if(revision == _faces_revision)
+		return;
+
+	upload(_indices, fcs.data(), fcs.size() * sizeof(Trig));
+	_index_count = fcs.size() * 3;
+	_index_span = 0;
+	_faces_revision = revision;
+
+	for(unsigned i(0); i != fcs.size(); ++i) {
+		const Trig& f(fcs[i]);
+		const unsigned last(std::max(f.a, std::max(f.b, f.c)));
+		_index_span = std::max(_index_span, last + 1);
+	}
+}
+
+
+void glBlendProgram::background(const color& bg) {
+	_program.bind();
+	_program.setUniformValue("background", bg.r, bg.g, bg.b, bg.a);
+	_program.release();
+}
+
+
+void glBlendProgram::draw(const int src_tex, const int dst_tex, const float t)
+{
+	// painted by a render thread, the meshes and the faces may be caught
+	// half way through a change of resolution, the next paint has them all
+	if(_index_count == 0 or _vertex_count[SRC] != _vertex_count[DST] or
+	   _index_span > _vertex_count[SRC])
+		return;
+
+	_program.bind();
+	_program.setUniformValue(_t, t);
+	_program.setUniformValue(_has_src, src_tex != 0 ? 1.0f : 0.0f);
+	_program.setUniformValue(_weight, dst_tex != 0 ? t : 0.0f);
+
+	for(unsigned i(0); i != SOURCES; ++i) {
+		_vertices[i].bind();
+		_program.setAttributeBuffer(_attributes[i], GL_FLOAT, 0, 2);
+		_program.enableAttributeArray(_attributes[i]);
+	}
+
+	_vertices[DST].release();
+	_indices.bind();
+
+	_active_texture(GL_TEXTURE0 + DST);
+	glBindTexture(GL_TEXTURE_2D, dst_tex);
+	_active_texture(GL_TEXTURE0 + SRC);
+	glBindTexture(GL_TEXTURE_2D, src_tex);
+
+	glDrawElements(GL_TRIANGLES, _index_count, GL_UNSIGNED_INT, 0);
+
+	_active_texture(GL_TEXTURE0 + DST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	_active_texture(GL_TEXTURE0 + SRC);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	_indices.release();
+
+	for(unsigned i(0); i != SOURCES; ++i)
+		_program.disableAttributeArray(_attributes[i]);
+
+	_program.release();
+}
+
+
+/* ************************************************************************** *
+ * Utilities implementation
+ * ************************************************************************** */
+
+void upload(QGLBuffer& buffer, const void* const data, const int bytes) {
+	buffer.bind();
+
+	if(buffer.size() == bytes)
+		buffer.write(0, data, bytes); // glBufferSubData, keeps the storage
+	else
+		buffer.allocate(data, bytes);
+
+	buffer.release();
+}
+
+
+bool same(const vec2& a, const vec2& b) {
+	return a.x == b.x and a.y == b.y;
+}
+
+
+template<typename F>
+F resolve(const QGLContext* const context, const char* const name) {
+	return reinterpret_cast<F>(context->getProcAddress(QString(name)));
+}
@@ -23,14 +23,15 @@
  */
 
 #include "glu.hpp"
-#include "QRTT.hpp"
 #include "glFFDWidget.hpp"
 #include "glBlendWidget.hpp"
+#include "RenderThread.hpp"
 
 #include <QDrag>
 #include <QPixmap>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QResizeEvent>
 #include <QApplication>
 
 #include <algorithm>
@@ -39,21 +40,42 @@
 
 const color CLEAR_COLOR(1.0f, 1.0f, 1.0f, 1.0f);
 
+typedef std::lock_guard<std::mutex> StateLock;
+
+
+/* ************************************************************************** *
+ * Utilities forward declaration
+ * ************************************************************************** */
+
+/// @brief fits tells whether every vertex of 'faces' is in 'mesh'
+bool fits(const Faces& faces, const Mesh& mesh);
+
+
+/* ************************************************************************** *
+ * glBlendWidget implementation
+ * ************************************************************************** */
+
 
 glBlendWidget::glBlendWidget(QWidget* parent):
 	QGLWidget(parent),
 	_t(0.0f),
 	_src(0),
-	_dst(0)
+	_dst(0),
+	_faces_revision(0),
+	_dirty(true)
 {
 	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 }
 
 
-glBlendWidget::~glBlendWidget() {}
+glBlendWidget::~glBlendWidget() {
+	makeCurrent(); // frees the buffers of _program
+	_program.reset(nullptr);
+}
 
 
 void glBlendWidget::src(glFFDWidget* const w) {
+	follow(_src, w);
 	_src = w;
 	assert(invariant());
 	updateFaces();
@@ -61,6 +83,7 @@ void glBlendWidget::src(glFFDWidget* const w) {
 
 
 void glBlendWidget::dst(glFFDWidget* const w) {
+	follow(_dst, w);
 	_dst = w;
 	assert(invariant());
 	updateFaces();
@@ -73,29 +96,112 @@ bool glBlendWidget::invariant() const {
 }
 
 
+void glBlendWidget::follow(glFFDWidget* const old, glFFDWidget* const w) {
+	if(old != 0)
+		disconnect(old, SIGNAL(changed()), this, SLOT(invalidate()));
+
+	if(w != 0)
+		connect(w, SIGNAL(changed()), this, SLOT(invalidate()));
+}
+
+
 void glBlendWidget::blendFactor(float t) {
-	_t = std::min(std::max(t, 0.0f), 1.0f);
+	const float old(_t);
+
+	{
+		const StateLock lock(_state_lock);
+		_t = std::min(std::max(t, 0.0f), 1.0f);
+	}
+
+	if(_t != old)
+		invalidate();
+
 	emit blendFactorChanged(_t);
 }
 
 
+void glBlendWidget::invalidate() {
+	if(not _dirty) {
+		_dirty = true;
+		RenderThread* const thread(RenderThread::owner(this));
+
+		if(thread != nullptr)
+			thread->paint(this); // at once, not after the events queued
+		else
+			update(); // posted, paints once the events before it are handled
+	}
+}
+
+
 bool glBlendWidget::canPaint() const {
 	return src() != 0 and dst() != 0 and
 			(src()->tex() != 0 or dst()->tex() != 0);
 }
 
+
 void glBlendWidget::paintGL() {
+	_dirty = false;
 	glClear(GL_COLOR_BUFFER_BIT);
 
-	if(canPaint())
-		drawBlended(src()->mesh(), dst()->mesh(), faces(),
-					src()->tex(), dst()->tex(), blendFactor());
+	if(src() == 0 or dst() == 0)
+		return;
+
+	// a render thread paints while the GUI thread edits, so each part of
+	// the state is read under its own lock, one lock at a time
+	float t(0.0f);
+	Faces faces; // copies for drawBlended()
+	Mesh src_mesh;
+	Mesh dst_mesh;
+
+	{
+		const StateLock lock(_state_lock);
+		t = _t;
+
+		if(_program != nullptr)
+			_program->faces(_faces, _faces_revision);
+		else
+			faces = _faces;
+	}
+
+	const GLuint src_tex(source(glBlendProgram::SRC, src(), src_mesh));
+	const GLuint dst_tex(source(glBlendProgram::DST, dst(), dst_mesh));
+
+	if(src_tex == 0 and dst_tex == 0)
+		return;
+
+	if(_program != nullptr)
+		_program->draw(src_tex, dst_tex, t);
+	else if(src_mesh.size() == dst_mesh.size() and fits(faces, src_mesh))
+		drawBlended(src_mesh, dst_mesh, faces, src_tex, dst_tex, t);
+}
+
+
+GLuint glBlendWidget::source(const glBlendProgram::Source s,
+							 const glFFDWidget* const w,
+							 Mesh& copy)
+{
+	const std::lock_guard<std::recursive_mutex> lock(w->stateLock());
+
+	if(_program != nullptr)
+		_program->mesh(s, w->mesh(), w->meshRevision());
+	else
+		copy = w->mesh();
+
+	return w->tex();
 }
 
 
 void glBlendWidget::initializeGL() {
 	glClearColor(CLEAR_COLOR.r, CLEAR_COLOR.g, CLEAR_COLOR.b, CLEAR_COLOR.a);
-	cgl::view2D(uvec2(), uvec2(width(), height()));
+	const QSize size(RenderThread::size(this));
+	cgl::view2D(uvec2(), uvec2(size.width(), size.height()));
+
+	_program.reset(new glBlendProgram);
+
+	if(_program->init(context()))
+		_program->background(CLEAR_COLOR);
+	else
+		_program.reset(nullptr);
 }
 
 
@@ -105,17 +211,22 @@ void glBlendWidget::resizeGL(int width, int height) {
 
 
 void glBlendWidget::updateFaces() {
-	_faces.clear();
+	{
+		const StateLock lock(_state_lock);
+		_faces.clear();
+		++_faces_revision;
 
-	if(src() == 0 or dst() == 0)
-		return;
+		if(src() != 0 and dst() != 0) {
+			assert(invariant());
 
-	assert(invariant());
+			assert(src()->resolution() != 0);
+			unsigned w(src()->resolution() - 1);
 
-	assert(src()->resolution() != 0);
-	unsigned w(src()->resolution() - 1);
+			generateTriangles(w, w, _faces);
+		}
+	}
 
-	generateTriangles(w, w, _faces);
+	invalidate();
 }
 
 
@@ -154,10 +265,9 @@ cgl::uvec2 glBlendWidget::dimensions(GLint tex) {
 	if(tex == 0)
 		return cgl::uvec2();
 
-	if(context() != QGLContext::currentContext())
-		makeCurrent();
-
-	return cgl::dimensions(tex);
+	cgl::uvec2 dim;
+	RenderThread::call(this, [tex, &dim]() { dim = cgl::dimensions(tex); });
+	return dim;
 }
 
 
@@ -179,45 +289,48 @@ QSize glBlendWidget::minImgDim() {
 }
 
 
-QSize glBlendWidget::fboDim() {
-	if(_rtt != nullptr)
-		return _rtt->size();
-
-	return size();
-}
-
-
 const Faces& glBlendWidget::faces() const {
 	return _faces;
 }
 
 
-void glBlendWidget::beginAnimation(const QSize& size) {
-	assert(_rtt == nullptr);
-	_rtt.reset(new QRTT(this, size));
+QImage glBlendWidget::frame() {
+	QImage img;
+	RenderThread::call(this, [this, &img]() {
+		img = grabFrameBuffer().convertToFormat(QImage::Format_RGBA8888);
+	});
+	return img;
 }
 
 
-void glBlendWidget::refresh() {
-	if(_rtt != nullptr)
-		_rtt->bind();
-
-	paintGL();
+void glBlendWidget::renderIn(RenderThread* const thread) {
+	RenderThread::View view;
+	view.initialize = [this]() { initializeGL(); };
+	view.resize = [this](int width, int height) { resizeGL(width, height); };
+	view.paint = [this]() { paintGL(); };
+	thread->add(this, view);
 }
 
 
-QImage glBlendWidget::frame() {
-	const QImage& img((_rtt != nullptr? _rtt->image() : grabFrameBuffer()));
-
-	if(img.format() != QImage::Format_RGBA8888)
-		return img.convertToFormat(QImage::Format_RGBA8888);
+void glBlendWidget::paintEvent(QPaintEvent* event) {
+	RenderThread* const thread(RenderThread::owner(this));
 
-	return img;
+	if(thread != nullptr)
+		thread->paint(this);
+	else
+		QGLWidget::paintEvent(event);
 }
 
 
-void glBlendWidget::endAnimation() {
-	_rtt.reset(nullptr);
+void glBlendWidget::resizeEvent(QResizeEvent* event) {
+	RenderThread* const thread(RenderThread::owner(this));
+
+	if(thread != nullptr) {
+		QWidget::resizeEvent(event); // no context here
+		thread->resize(this, event->size() * devicePixelRatio());
+	}
+	else
+		QGLWidget::resizeEvent(event);
 }
 
 
@@ -235,3 +348,20 @@ const float& glBlendWidget::blendFactor() const {
 	return _t;
 }
 
+
+/* ************************************************************************** *
+ * Utilities implementation
+ * ************************************************************************** */
+
+bool fits(const Faces& faces, const Mesh& mesh) {
+	const unsigned N(mesh.size());
+
+	for(unsigned i(0); i != faces.size(); ++i) {
+		const Trig& f(faces[i]);
+
+		if(f.a >= N or f.b >= N or f.c >= N)
+			return false;
+	}
+
+	return true;
+}
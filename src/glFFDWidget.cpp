@@ -25,20 +25,25 @@
 #include "glu.hpp"
 #include "QRTT.hpp"
 #include "glFFDWidget.hpp"
+#include "RenderThread.hpp"
 #include "SignalBlocker.hpp"
 
 #include <QUrl>
 #include <QDrag>
 #include <QMimeData>
+#include <QScreen>
 #include <QMouseEvent>
+#include <QResizeEvent>
 #include <QApplication>
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 
 
 typedef glFFDWidget::vec2 vec2;
 typedef glFFDWidget::color color;
+typedef std::lock_guard<std::recursive_mutex> StateLock;
 
 const unsigned DEFAULT_RESOLUTION(10);
 const unsigned MINIMUM_RESOLUTION(2);
@@ -62,6 +67,14 @@ unsigned totalNumberOfIndices(const unsigned width) {
 }
 
 
+/// the time between two frames of the display, in ms
+int refreshPeriod() {
+	const QScreen* const screen(QGuiApplication::primaryScreen());
+	const qreal rate(screen != 0 ? screen->refreshRate() : 0.0);
+	return rate > 0.0 ? std::max(1, int(1000.0 / rate)) : 1000 / 60;
+}
+
+
 glFFDWidget::glFFDWidget(QWidget* const parent,
 						 QGLWidget* const shared_widget):
 	QGLWidget(parent, shared_widget),
@@ -69,24 +82,43 @@ glFFDWidget::glFFDWidget(QWidget* const parent,
 	_selection(NO_SELECTION),
 	_draw_mesh(DEFAULT_DRAW_MESH_STATE),
 	_modified(false),
-	_resolution(DEFAULT_RESOLUTION)
+	_resolution(DEFAULT_RESOLUTION),
+	_mesh_revision(0),
+	_indices_buffer(QGLBuffer::IndexBuffer),
+	_mesh_bytes(0),
+	_dirty_first(0),
+	_dirty_last(0),
+	_dirty_indices(false),
+	_dirty(true),
+	_drag_pending(false),
+	_latency("glFFDWidget")
 {
 	setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 	setAcceptDrops(true);
 	resetMesh();
+
+	_drag_timer.setSingleShot(true);
+	_drag_timer.setTimerType(Qt::PreciseTimer);
+	connect(&_drag_timer, SIGNAL(timeout()), this, SLOT(applyDrag()));
 }
 
 
 glFFDWidget::~glFFDWidget() {
 	clear();
+	makeCurrent(); // frees the mesh buffers
+	_mesh_buffer.destroy();
+	_indices_buffer.destroy();
 }
 
 
 void glFFDWidget::clear() {
 	warnChanges();
-	const SignalBlocker block(this);
-	resetMesh();
-	clearTex();
+	{
+		const SignalBlocker block(this);
+		resetMesh();
+		clearTex();
+	}
+	emit changed();
 }
 
 
@@ -95,15 +127,18 @@ void glFFDWidget::resolution(const unsigned n) {
 	{
 		const SignalBlocker block(this);
 		assert(n >= MINIMUM_RESOLUTION);
+		const StateLock lock(_state_lock);
 		_resolution = n;
 		resetMesh();
 	}
+	emit changed();
 	emit resolutionChanged(resolution());
 }
 
 
 void glFFDWidget::resetMesh() {
 	warnChanges();
+	const StateLock lock(_state_lock);
 	selectAndPropagate(NO_SELECTION);
 	initMesh();
 	initIndices();
@@ -113,7 +148,22 @@ void glFFDWidget::resetMesh() {
 void glFFDWidget::initializeGL() {
 	glClearColor(CLEAR_COLOR.r, CLEAR_COLOR.g, CLEAR_COLOR.b, CLEAR_COLOR.a);
 	glPointSize(POINT_SIZE);
-	cgl::view2D(uvec2(), uvec2(width(), height()));
+	const QSize size(RenderThread::size(this));
+	cgl::view2D(uvec2(), uvec2(size.width(), size.height()));
+
+	const StateLock lock(_state_lock);
+	_latency.name(objectName().toStdString()); // set up by now
+
+	// without buffer objects the mesh is drawn from client memory
+	_mesh_buffer.setUsagePattern(QGLBuffer::DynamicDraw);
+	_indices_buffer.setUsagePattern(QGLBuffer::StaticDraw);
+
+	_mesh_bytes = 0;
+
+	if(_mesh_buffer.create() and _indices_buffer.create()) {
+		meshChanged(0, mesh().size());
+		_dirty_indices = true;
+	}
 }
 
 
@@ -124,14 +174,24 @@ void glFFDWidget::resizeGL(int width, int height) {
 
 void glFFDWidget::paintGL() {
 	selectGLContext();
+	_dirty = false;
+
+	const StateLock lock(_state_lock);
+	_latency.paint();
+	paint(isDrawingMesh());
+}
+
 
+void glFFDWidget::paint(const bool with_mesh) {
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	if(validTex())
 		drawTex();
 
-	if(isDrawingMesh())
+	if(with_mesh) {
+		uploadMesh();
 		draw();
+	}
 }
 
 
@@ -141,13 +201,13 @@ void glFFDWidget::drawTex() const {
 }
 
 
-void glFFDWidget::draw() const {
+void glFFDWidget::draw() {
 	drawMesh();
 	drawSelection();
 }
 
 
-void glFFDWidget::drawMesh() const {
+void glFFDWidget::drawMesh() {
 	if(mesh().empty())
 		return;
 
@@ -155,12 +215,17 @@ void glFFDWidget::drawMesh() const {
 	assert(mesh().size() == (resolution() * resolution()));
 	assert(num_idx == totalNumberOfIndices(resolution()));
 
-	glVertexPointer(2, GL_FLOAT, 0, &mesh().front().x);
+	// buffer offsets or client memory
+	const bool bound(bindMesh());
+	const GLvoid* const vertices(bound ? 0 : &mesh().front().x);
+	const GLvoid* const lines(bound ? 0 : &indices().front());
+
+	glVertexPointer(2, GL_FLOAT, 0, vertices);
 	glEnableClientState(GL_VERTEX_ARRAY);
 
 	{ // draw horizontal and vertical lines followed by points.
 		const cgl::BindColor state(LINE_COLOR);
-		glDrawElements(GL_LINES, num_idx, GL_UNSIGNED_INT, &indices().front());
+		glDrawElements(GL_LINES, num_idx, GL_UNSIGNED_INT, lines);
 	}
 	{
 		const cgl::BindColor state(POINT_COLOR);
@@ -168,19 +233,103 @@ void glFFDWidget::drawMesh() const {
 	}
 
 	glDisableClientState(GL_VERTEX_ARRAY);
+	releaseMesh();
 }
 
 
-void glFFDWidget::drawSelection() const {
+void glFFDWidget::drawSelection() {
 	if(not hasSelection())
 		return;
 
 	const cgl::BindColor state(POINT_SELECTION_COLOR);
 
-	glVertexPointer(2, GL_FLOAT, 0, &mesh()[selection()]);
+	const bool bound(bindMesh());
+	glVertexPointer(2, GL_FLOAT, 0, bound ? 0 : &mesh().front().x);
 	glEnableClientState(GL_VERTEX_ARRAY);
-	glDrawArrays(GL_POINTS, 0, 1);
+	glDrawArrays(GL_POINTS, selection(), 1);
 	glDisableClientState(GL_VERTEX_ARRAY);
+	releaseMesh();
+}
+
+
+void glFFDWidget::meshChanged(const unsigned first, const unsigned last) {
+	assert(first <= last);
+	++_mesh_revision;
+	invalidate();
+	emit changed();
+
+	if(_dirty_first == _dirty_last) {
+		_dirty_first = first;
+		_dirty_last = last;
+	}
+	else {
+		_dirty_first = std::min(_dirty_first, first);
+		_dirty_last = std::max(_dirty_last, last);
+	}
+}
+
+
+void glFFDWidget::invalidate() {
+	if(not _dirty) {
+		_dirty = true;
+		RenderThread* const thread(RenderThread::owner(this));
+
+		if(thread != nullptr)
+			thread->paint(this); // at once, not after the events queued
+		else
+			update(); // posted, paints once the events before it are handled
+	}
+}
+
+
+void glFFDWidget::uploadMesh() {
+	if(not _mesh_buffer.isCreated() or mesh().empty())
+		return;
+
+	const int bytes(mesh().size() * sizeof(vec2));
+
+	if(_mesh_bytes != bytes) {
+		_mesh_buffer.bind();
+		_mesh_buffer.allocate(&mesh().front(), bytes);
+		_mesh_buffer.release();
+		_mesh_bytes = bytes;
+	}
+	else if(_dirty_first != _dirty_last) {
+		assert(_dirty_last <= mesh().size());
+		_mesh_buffer.bind();
+		_mesh_buffer.write(_dirty_first * sizeof(vec2), &mesh()[_dirty_first],
+						   (_dirty_last - _dirty_first) * sizeof(vec2));
+		_mesh_buffer.release();
+	}
+
+	_dirty_first = _dirty_last = 0;
+
+	if(_dirty_indices) {
+		_indices_buffer.bind();
+		_indices_buffer.allocate(&indices().front(),
+								 indices().size() * sizeof(unsigned));
+		_indices_buffer.release();
+		_dirty_indices = false;
+	}
+}
+
+
+bool glFFDWidget::bindMesh() {
+	if(not _mesh_buffer.isCreated())
+		return false;
+
+	_mesh_buffer.bind();
+	_indices_buffer.bind();
+	return true;
+}
+
+
+void glFFDWidget::releaseMesh() {
+	if(not _mesh_buffer.isCreated())
+		return;
+
+	_mesh_buffer.release();
+	_indices_buffer.release();
 }
 
 
@@ -203,17 +352,50 @@ void glFFDWidget::mouseMoveEvent(QMouseEvent* event) {
 	if(not (event->buttons() & Qt::LeftButton))
 		return;
 
-	if(hasSelection())
-		moveSelectionTo(event->pos());
+	if(hasSelection()) {
+		if(not _drag_pending)
+			_drag_since = LatencyMeter::Clock::now();
+
+		_drag_to = event->pos();
+		_drag_pending = true;
+
+		// the first move is shown at once, the moves that follow within a
+		// display refresh only by the last of them
+		if(not _drag_timer.isActive())
+			applyDrag();
+	}
 	else if((event->pos() - _mouse).manhattanLength() >=
 			  QApplication::startDragDistance())
 		dragEvent();
 }
 
 
+void glFFDWidget::mouseReleaseEvent(QMouseEvent*) {
+	_drag_timer.stop();
+	applyDrag();
+}
+
+
+void glFFDWidget::applyDrag() {
+	if(not _drag_pending)
+		return;
+
+	_drag_pending = false;
+
+	if(hasSelection()) {
+		moveSelectionTo(_drag_to);
+		_drag_timer.start(refreshPeriod());
+	}
+}
+
+
 void glFFDWidget::moveSelectionTo(const QPoint& p) {
 	assert(hasSelection());
-	_mesh[selection()] = normalize(p.x(), p.y());
+	const vec2& v(normalize(p.x(), p.y()));
+	const StateLock lock(_state_lock);
+	_latency.input(_drag_since);
+	_mesh[selection()] = v;
+	meshChanged(selection(), selection() + 1);
 	postModified();
 }
 
@@ -263,7 +445,11 @@ void glFFDWidget::select(const vec2& p) {
 void glFFDWidget::select(int i) {
 	if(_selection != i) {
 		assert(NO_SELECTION <= i and i < int(mesh().size()));
-		_selection = i;
+		{
+			const StateLock lock(_state_lock);
+			_selection = i;
+		}
+		invalidate();
 	}
 }
 
@@ -319,16 +505,26 @@ void glFFDWidget::mesh(const Mesh& msh) {
 	assert(n * n == N);
 
 	selectAndPropagate(NO_SELECTION);
-	_resolution = n;
-	_mesh = msh;
-	initIndices();
+	{
+		const StateLock lock(_state_lock);
+		_resolution = n;
+		_mesh = msh;
+		meshChanged(0, _mesh.size());
+		initIndices();
+	}
 	emit resolutionChanged(resolution());
 	clearModification();
 }
 
 
 void glFFDWidget::drawMesh(const bool status) {
-	_draw_mesh = status;
+	if(_draw_mesh != status) {
+		{
+			const StateLock lock(_state_lock);
+			_draw_mesh = status;
+		}
+		invalidate();
+	}
 }
 
 
@@ -339,8 +535,13 @@ void glFFDWidget::clearTex() {
 
 void glFFDWidget::tex(const GLuint tx) {
 	if(_tex != tx) {
-		_tex = tx;
+		{
+			const StateLock lock(_state_lock);
+			_tex = tx;
+		}
 		postModified();
+		invalidate();
+		emit changed();
 	}
 }
 
@@ -365,6 +566,7 @@ void glFFDWidget::initMesh() {
 	}
 
 	assert(_mesh.size() == (width * width));
+	meshChanged(0, _mesh.size());
 }
 
 
@@ -391,6 +593,7 @@ void glFFDWidget::initIndices() {
 		}
 
 	assert(_indices.size() == num_indices);
+	_dirty_indices = true;
 }
 
 
@@ -423,23 +626,56 @@ void glFFDWidget::dropEvent(QDropEvent* event) {
 
 
 QImage glFFDWidget::frame() {
-	if(validTex()) {
-		const bool mesh_state(isDrawingMesh());
-		drawMesh(false);
-
-		selectGLContext();
+	if(not validTex())
+		return QImage();
 
+	// offscreen, so the view keeps its mesh, pending paint and latency
+	QImage img;
+	RenderThread::call(this, [this, &img]() {
 		const cgl::uvec2& dim(cgl::dimensions(tex()));
-		QRTT rtt(this, QSize(dim.x, dim.y));
+		QRTT rtt(this, QSize(dim.x, dim.y), &_rtt_pool);
+		{
+			const StateLock lock(_state_lock);
+			paint(false);
+		}
+		img = rtt.image();
+	});
+
+	return img;
+}
 
-		paintGL();
 
-		drawMesh(mesh_state);
+void glFFDWidget::renderIn(RenderThread* const thread) {
+	RenderThread::View view;
+	view.initialize = [this]() { initializeGL(); };
+	view.resize = [this](int width, int height) { resizeGL(width, height); };
+	view.paint = [this]() { paintGL(); };
+	view.swapped = [this]() { _latency.shown(); };
+	thread->add(this, view);
+}
+
 
-		return rtt.image();
+void glFFDWidget::paintEvent(QPaintEvent* event) {
+	RenderThread* const thread(RenderThread::owner(this));
+
+	if(thread != nullptr)
+		thread->paint(this);
+	else {
+		QGLWidget::paintEvent(event); // swaps the buffers
+		_latency.shown();
 	}
+}
+
 
-	return QImage();
+void glFFDWidget::resizeEvent(QResizeEvent* event) {
+	RenderThread* const thread(RenderThread::owner(this));
+
+	if(thread != nullptr) {
+		QWidget::resizeEvent(event); // no context here
+		thread->resize(this, event->size() * devicePixelRatio());
+	}
+	else
+		QGLWidget::resizeEvent(event);
 }
 
 
@@ -464,6 +700,24 @@ void glFFDWidget::uri(const QString& new_uri) {
 }
 
 
+QImage glFFDWidget::image() {
+	if(not validTex())
+		return QImage();
+
+	QImage img;
+	RenderThread::call(this, [this, &img]() {
+		const cgl::uvec2& dim(cgl::dimensions(tex()));
+		img = QImage(dim.x, dim.y, QImage::Format_RGBA8888);
+		const cgl::BindTexture2D binder(tex());
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, img.bits());
+	});
+
+	// bindTexture flipped the rows on upload
+	return img.mirrored();
+}
+
+
 void glFFDWidget::selectGLContext() {
 	if(context() != QGLContext::currentContext())
 		makeCurrent();
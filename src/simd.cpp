@@ -0,0 +1,78 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "simd.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+
+const char* const SIMD_NAMES[] = { "scalar", "sse2", "avx2", "neon" };
+const char* const SIMD_ENV("FFD_SIMD");
+
+
+SimdLevel detectSimdLevel() {
+#if SIMD_X86
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+
+	if(__builtin_cpu_supports("sse2"))
+		return SIMD_SSE2;
+#elif SIMD_NEON
+	return SIMD_NEON_LEVEL; // mandatory on aarch64
+#endif
+	return SIMD_SCALAR;
+}
+
+
+SimdLevel limitSimdLevel(const SimdLevel level) {
+	const char* const env(std::getenv(SIMD_ENV));
+
+	if(env == 0)
+		return level;
+
+	if(std::strcmp(env, SIMD_NAMES[SIMD_SCALAR]) == 0)
+		return SIMD_SCALAR;
+
+	// x86 levels are supersets of the lower ones.
+	if(level != SIMD_NEON_LEVEL)
+		for(unsigned i(0); i <= unsigned(level); ++i)
+			if(std::strcmp(env, SIMD_NAMES[i]) == 0)
+				return SimdLevel(i);
+
+	return level;
+}
+
+
+SimdLevel simdLevel() {
+	static const SimdLevel level(limitSimdLevel(detectSimdLevel()));
+	return level;
+}
+
+
+const char* simdName(const SimdLevel level) {
+	return SIMD_NAMES[level];
+}
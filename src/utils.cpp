@@ -46,20 +46,6 @@ void interpolate(const Mesh& a,
 }
 
 
-bool glBlendAlphaEquals(const float& a) {
-	float bc[4] = {-1.0f, -1.0f, -1.0f, -1.0f};
-	glGetFloatv(GL_BLEND_COLOR, bc);
-	const bool equal(bc[3] == a);
-
-	if(not equal) {
-		cgl::printGlError();
-		return false;
-	}
-
-	return true;
-}
-
-
 void draw(const int tex,
 		  const Mesh& mesh,
 		  const Mesh& tc,
@@ -128,11 +114,7 @@ void drawBlended(const Mesh& src_mesh,
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
 
-		if(not glBlendAlphaEquals(t)) {
-			glBlendColor(0.0f, 0.0f, 0.0f, t);
-			assert(glBlendAlphaEquals(t));
-		}
-
+		glBlendColor(0.0f, 0.0f, 0.0f, t);
 		draw(dst_tex, mesh, dst_mesh, faces);
 	}
 
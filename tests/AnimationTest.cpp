@@ -0,0 +1,302 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "Animation.hpp"
+
+#include <cstring>
+#include <vector>
+
+
+typedef Animation::byte byte;
+typedef std::vector<byte> Bytes;
+
+const unsigned W(4), H(3);
+const std::string URI("AnimationTest.gif");
+
+
+/// a call to the writer
+struct Call {
+	char kind; // 'a'ppend, 'r'epeat or 'e'xtend
+	unsigned frame; // the written frame added, repeated or extended
+	unsigned delay;
+
+	bool operator==(const Call& other) const {
+		return kind == other.kind and frame == other.frame and
+			   delay == other.delay;
+	}
+};
+
+typedef std::vector<Call> Calls;
+
+
+/// what the writers were asked, and how they answer
+struct Log {
+	Calls calls;
+	std::vector<bool> kept; // whether each written frame can be repeated
+	bool extendable; // whether extendFrame succeeds
+	uint64_t key; // of the frames resume() gives
+	std::vector<AnimationWriter::Stored> stored;
+} writes;
+
+
+/**
+ * @brief The StubWriter class writes nothing, it logs the calls and refuses
+ * what the real writers refuse.
+ */
+class StubWriter : public AnimationWriter {
+public:
+	bool open(const std::string&) {
+		writes.calls.clear();
+		writes.kept.clear();
+		return true;
+	}
+
+	bool resume(const uint64_t key, std::vector<Stored>& stored) {
+		if(key != writes.key or not writes.kept.empty())
+			return false;
+
+		stored = writes.stored;
+		for(unsigned i(0); i != stored.size(); ++i)
+			writes.kept.push_back(stored[i].keep);
+		return true;
+	}
+
+	bool appendFrame(const unsigned,
+					 const unsigned,
+					 const byte*,
+					 const unsigned delay,
+					 const bool keep)
+	{
+		const Call call = {'a', unsigned(writes.kept.size()), delay};
+		writes.calls.push_back(call);
+		writes.kept.push_back(keep);
+		return true;
+	}
+
+	bool repeatFrame(const unsigned frame, const unsigned delay) {
+		if(frame >= writes.kept.size() or not writes.kept[frame])
+			return false;
+
+		const Call call = {'r', frame, delay};
+		writes.calls.push_back(call);
+		writes.kept.push_back(true);
+		return true;
+	}
+
+	bool extendFrame(const unsigned delay) {
+		if(not writes.extendable or writes.kept.empty())
+			return false;
+
+		const Call call = {'e', unsigned(writes.kept.size() - 1), delay};
+		writes.calls.push_back(call);
+		return true;
+	}
+
+	bool finish() {
+		return true;
+	}
+
+	void cancel(const bool) {}
+};
+
+
+/// the writers made by Animation
+AnimationWriter::Ptr AnimationWriter::create(const std::string&,
+											 const PixelFormat,
+											 const bool)
+{
+	return Ptr(new StubWriter);
+}
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void hashes();
+
+void duplicates();
+
+void repeats();
+
+void resumed();
+
+uint64_t hash(const char* text, const uint64_t seed = 0);
+
+bool add(Animation& animation, const byte value, const bool keep = false);
+
+Call call(const char kind, const unsigned frame, const unsigned delay);
+
+
+/* *****************************************************************************
+ * Frames that show the same pixels are written once, and repeats refer to
+ * frames that were kept.
+ * ****************************************************************************/
+int main() {
+	hashes();
+	duplicates();
+	repeats();
+	resumed();
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// known answers of the reference XXH64
+void hashes() {
+	// no input, below 32 bytes and every tail, and seeded
+	CHECK(hash("") == 0xEF46DB3751D8E999ULL);
+	CHECK(hash("", 1) == 0xD5AFBA1336A3BE4BULL);
+	CHECK(hash("hello, world") == 0xB33A384E6D1B1242ULL);
+
+	const char* const lanes("abcdefghijklmnopqrstuvwxyz"
+							"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789$");
+	CHECK(hash(lanes) == 0x1032D841E824F998ULL);
+	CHECK(hash(lanes, 0x9E3779B97F4A7C15ULL) == 0x9AC37C61F5A52B41ULL);
+
+	// unaligned input hashes the same
+	const std::size_t size(std::strlen(lanes));
+	Bytes shifted(size + 1);
+	std::memcpy(&shifted[1], lanes, size);
+	CHECK(Animation::hash(&shifted[1], size) == 0x1032D841E824F998ULL);
+}
+
+
+/// the same pixels extend the last frame, unless a kept one is needed
+void duplicates() {
+	unsigned added(0);
+	Animation animation([&added](const unsigned frames) {
+		added = frames;
+		return true;
+	});
+	writes.extendable = true;
+	CHECK(animation.open(URI));
+
+	CHECK(add(animation, 1));
+	CHECK(add(animation, 1));
+	CHECK(add(animation, 2));
+	CHECK(add(animation, 2, true)); // not merged into a frame not kept
+	CHECK(add(animation, 2, true));
+	CHECK(add(animation, 2)); // merged into a kept one
+	CHECK(add(animation, 1, true));
+	CHECK(animation.frameCount() == 7 and added == 7);
+
+	const Call calls[] = {
+		call('a', 0, 1), call('e', 0, 1), call('a', 1, 1), call('a', 2, 1),
+		call('e', 2, 1), call('e', 2, 1), call('a', 3, 1)
+	};
+	CHECK(writes.calls == Calls(calls, calls + 7));
+
+	// a writer that can not extend the frame writes it again
+	writes.extendable = false;
+	CHECK(add(animation, 1));
+	CHECK(writes.calls.back() == call('a', 4, 1));
+	animation.cancel();
+	CHECK(not add(animation, 1));
+}
+
+
+/// repeats refer to kept frames, even when they extend one that is not
+void repeats() {
+	Animation animation;
+	writes.extendable = true;
+	CHECK(animation.open(URI));
+
+	CHECK(add(animation, 1, true));
+	CHECK(add(animation, 2));
+	CHECK(add(animation, 1));
+	CHECK(animation.repeatFrame(0, 5)); // extends frame 2, not kept
+	CHECK(add(animation, 3));
+	CHECK(animation.repeatFrame(3, 6)); // repeats frame 0
+	CHECK(animation.repeatFrame(5, 7)); // the same image, extended
+	CHECK(not animation.repeatFrame(1, 1)); // not kept
+	CHECK(not animation.repeatFrame(7, 1)); // not there
+	CHECK(animation.frameCount() == 7);
+
+	const Call calls[] = {
+		call('a', 0, 1), call('a', 1, 1), call('a', 2, 1), call('e', 2, 5),
+		call('a', 3, 1), call('r', 0, 6), call('e', 4, 7)
+	};
+	CHECK(writes.calls == Calls(calls, calls + 7));
+	animation.cancel();
+}
+
+
+/// the stored frames stand for the frames added before, by index
+void resumed() {
+	const AnimationWriter::Stored stored[] = {{2, true}, {1, false}, {3, true}};
+	writes.key = 42;
+	writes.stored.assign(stored, stored + 3);
+	writes.extendable = true;
+
+	Animation animation;
+	CHECK(animation.open(URI));
+	CHECK(animation.resume(41) == 0); // a stale key
+
+	CHECK(animation.open(URI));
+	CHECK(animation.resume(42) == 6);
+	CHECK(animation.frameCount() == 6);
+	CHECK(animation.resume(42) == 0); // only once
+
+	CHECK(animation.repeatFrame(1, 2)); // of the first stored frame
+	CHECK(animation.repeatFrame(5, 3)); // of the third
+	CHECK(not animation.repeatFrame(2, 1)); // the second is not kept
+	CHECK(animation.repeatFrame(6, 4)); // a repeat of the first again
+	CHECK(add(animation, 1));
+	CHECK(animation.frameCount() == 10);
+
+	const Call calls[] = {
+		call('r', 0, 2), call('r', 2, 3), call('r', 0, 4), call('a', 6, 1)
+	};
+	CHECK(writes.calls == Calls(calls, calls + 4));
+
+	// the pixels of stored frames are unknown, nothing extends them
+	CHECK(animation.open(URI));
+	CHECK(animation.resume(42) == 6);
+	CHECK(add(animation, 0));
+	CHECK(writes.calls.size() == 1 and writes.calls[0] == call('a', 3, 1));
+	animation.cancel();
+}
+
+
+uint64_t hash(const char* const text, const uint64_t seed) {
+	return Animation::hash(reinterpret_cast<const byte*>(text),
+						   std::strlen(text), seed);
+}
+
+
+/// a frame of pixels of the same 'value', shown for 1/100 s
+bool add(Animation& animation, const byte value, const bool keep) {
+	const Bytes pixels(W * H * 4, value);
+	return animation.addFrame(W, H, &pixels[0], 1, keep);
+}
+
+
+Call call(const char kind, const unsigned frame, const unsigned delay) {
+	const Call c = {kind, frame, delay};
+	return c;
+}
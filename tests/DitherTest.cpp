@@ -0,0 +1,117 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "Dither.hpp"
+#include "Quantizer.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+
+typedef unsigned char byte;
+typedef std::vector<byte> Bytes;
+
+const unsigned THREADS[] = {1, 2, 3, 8};
+const unsigned RUNS(sizeof(THREADS) / sizeof(THREADS[0]));
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void kernels();
+
+void pools();
+
+
+/* *****************************************************************************
+ * The indices depend neither on the instruction set nor on the threads.
+ * ****************************************************************************/
+int main() {
+	kernels();
+	pools();
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// the ordered dither, the one with kernels, of an image with many colors
+void kernels() {
+	const std::vector<SimdLevel> levels(test::levels());
+	std::srand(1);
+
+	const unsigned W(203), H(61);
+	const Bytes bits(test::image(W, H));
+	const ConstImageView img(&bits[0], W, H);
+
+	Quantizer quantizer(64);
+	quantizer.quantize(img);
+
+	Bytes expected;
+	Dither(Dither::ORDERED, 0, SIMD_SCALAR).map(img, quantizer, expected);
+	CHECK(expected.size() == W * H);
+
+	for(unsigned l(1); l < levels.size(); ++l) {
+		Bytes indices;
+		Dither(Dither::ORDERED, 0, levels[l]).map(img, quantizer, indices);
+		CHECK(indices == expected);
+	}
+
+	// without dithering, the nearest colors
+	Bytes nearest, indices;
+	quantizer.map(img, nearest);
+	Dither(Dither::NONE).map(img, quantizer, indices);
+	CHECK(indices == nearest);
+	CHECK(indices != expected);
+}
+
+
+/// rows mapped on any number of threads, the diffused ones in a pipeline
+void pools() {
+	std::srand(2);
+
+	const unsigned W(257), H(190);
+	const Bytes bits(test::image(W, H));
+	const ConstImageView img(&bits[0], W, H);
+	const Dither::Method methods[] = {Dither::ORDERED, Dither::FLOYD_STEINBERG};
+
+	for(unsigned m(0); m != 2; ++m) {
+		Quantizer quantizer(32);
+		quantizer.quantize(img);
+
+		Bytes expected;
+		Dither(methods[m]).map(img, quantizer, expected);
+
+		for(unsigned r(0); r != RUNS; ++r) {
+			ThreadPool threads(THREADS[r]);
+			Bytes indices;
+			Dither(methods[m], &threads).map(img, quantizer, indices);
+			CHECK(indices == expected);
+		}
+	}
+}
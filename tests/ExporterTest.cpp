@@ -0,0 +1,128 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "Exporter.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+
+typedef unsigned char byte;
+typedef std::vector<byte> Bytes;
+typedef std::vector<Bytes> Frames;
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+Exporter::OnFrame collect(Frames& frames);
+
+std::vector<float> blends(const unsigned count);
+
+
+/* *****************************************************************************
+ * Frames come in order and the same, whatever renders them.
+ * ****************************************************************************/
+int main() {
+	std::srand(1);
+
+	const unsigned W(140), H(90), COUNT(13);
+	const Bytes src_bits(test::image(40, 30)), dst_bits(test::image(30, 40));
+	const ConstImageView src(&src_bits[0], 40, 30), dst(&dst_bits[0], 30, 40);
+	const color background(0.1f, 0.2f, 0.3f, 1.0f);
+
+	Faces faces;
+	const Mesh src_mesh(test::mesh(6, 0.1f, faces));
+	const Mesh dst_mesh(test::mesh(6, 0.1f, faces));
+	const std::vector<float> ts(blends(COUNT));
+
+	Frames expected;
+	CHECK(Exporter(1, 1).run(src_mesh, dst_mesh, faces, src, dst,
+							 background, ts, W, H, collect(expected)));
+	CHECK(expected.size() == COUNT);
+
+	// frames held from one to more than rendered at once
+	const unsigned threads[] = {1, 2, 3, 8};
+
+	for(unsigned i(0); i != 4; ++i)
+		for(unsigned held(1); held < 6; held += 4) {
+			Frames frames;
+			CHECK(Exporter(threads[i], held).run(src_mesh, dst_mesh, faces,
+												 src, dst, background, ts,
+												 W, H, collect(frames)));
+			CHECK(frames == expected);
+		}
+
+	// fewer frames than threads, the tiles are shared out
+	for(unsigned count(1); count != 4; ++count) {
+		const std::vector<float> few(ts.begin(), ts.begin() + count);
+		Frames frames;
+		CHECK(Exporter(8).run(src_mesh, dst_mesh, faces, src, dst,
+							  background, few, W, H, collect(frames)));
+		CHECK(frames == Frames(expected.begin(), expected.begin() + count));
+	}
+
+	// stopped by the callback, the threads still end
+	unsigned seen(0);
+	CHECK(not Exporter(3, 2).run(src_mesh, dst_mesh, faces, src, dst,
+								 background, ts, W, H,
+								 [&seen](unsigned, const ConstImageView&) {
+									 return ++seen != 4;
+								 }));
+	CHECK(seen == 4);
+
+	// nothing to render
+	CHECK(Exporter(2).run(src_mesh, dst_mesh, faces, src, dst, background,
+						  std::vector<float>(), W, H,
+						  [](unsigned, const ConstImageView&) {
+							  return false;
+						  }));
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// copies the frames, checking they come in order
+Exporter::OnFrame collect(Frames& frames) {
+	return [&frames](const unsigned frame, const ConstImageView& img) {
+		const bool in_order(frame == frames.size());
+		CHECK(in_order);
+		frames.push_back(Bytes(img.bits, img.bits + img.stride * img.height));
+		return in_order;
+	};
+}
+
+
+std::vector<float> blends(const unsigned count) {
+	std::vector<float> ts(count);
+
+	for(unsigned i(0); i != count; ++i)
+		ts[i] = float(i) / (count - 1);
+
+	return ts;
+}
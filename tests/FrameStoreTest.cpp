@@ -0,0 +1,224 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "FrameStore.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <unistd.h>
+#include <vector>
+
+
+typedef FrameStore::byte byte;
+typedef std::vector<byte> Bytes;
+
+const unsigned W(20), H(10), PIXEL(4);
+const uint64_t KEY(7);
+const std::string PATH("FrameStoreTest.frames");
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void store(std::vector<Bytes>& frames);
+
+void resume(const std::vector<Bytes>& frames);
+
+void stopped(const std::vector<Bytes>& frames);
+
+bool holds(const FrameStore& store, const std::vector<Bytes>& frames);
+
+bool same(const FrameStore::Record& record,
+		  const unsigned delay,
+		  const unsigned source,
+		  const unsigned frames,
+		  const bool keep);
+
+uint64_t fileSize();
+
+void resize(const uint64_t size);
+
+
+/* *****************************************************************************
+ * Frames read back as stored, and from the file again when their key
+ * matches, up to the last one complete.
+ * ****************************************************************************/
+int main() {
+	std::srand(1);
+	std::vector<Bytes> frames;
+
+	store(frames);
+	resume(frames);
+	stopped(frames);
+
+	std::remove(PATH.c_str());
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// frames appended, a repeat of a kept one and an extended one
+void store(std::vector<Bytes>& frames) {
+	FrameStore store;
+	CHECK(not store.append(W, H, 0, 1, false)); // not open
+	CHECK(store.open(PATH, KEY, PIXEL, false));
+
+	for(unsigned i(0); i != 3; ++i) {
+		frames.push_back(test::image(W, H));
+		CHECK(store.append(W, H, &frames[i][0], i + 1, i == 1));
+	}
+
+	CHECK(not store.append(H, W, &frames[0][0], 1, false)); // another size
+	CHECK(store.repeat(1, 4));
+	frames.push_back(frames[1]);
+	CHECK(not store.repeat(0, 1)); // not kept
+	CHECK(not store.repeat(9, 1)); // not there
+	CHECK(store.extend(5));
+
+	CHECK(store.size() == 4 and store.width() == W and store.height() == H);
+	CHECK(same(store.record(0), 1, 0, 1, false));
+	CHECK(same(store.record(1), 2, 1, 1, true));
+	CHECK(same(store.record(2), 3, 2, 1, false));
+	CHECK(same(store.record(3), 4 + 5, 1, 2, true));
+	CHECK(holds(store, frames));
+}
+
+
+/// the frames of the same key and pixel size only
+void resume(const std::vector<Bytes>& frames) {
+	FrameStore store;
+	CHECK(store.open(PATH, KEY, PIXEL, true));
+	CHECK(store.size() == 4 and store.width() == W and store.height() == H);
+	CHECK(same(store.record(3), 9, 1, 2, true));
+	CHECK(holds(store, frames));
+
+	// what follows is stored after them, repeats of resumed frames too
+	std::vector<Bytes> more(frames);
+	more.push_back(test::image(W, H));
+	CHECK(store.append(W, H, &more.back()[0], 1, false));
+	CHECK(store.repeat(3, 1));
+	more.push_back(frames[1]);
+	CHECK(store.size() == 6 and holds(store, more));
+	store.close();
+
+	// a stale key empties the file
+	CHECK(store.open(PATH, KEY + 1, PIXEL, true));
+	CHECK(store.size() == 0);
+	CHECK(store.open(PATH, KEY, PIXEL, true));
+	CHECK(store.size() == 0);
+
+	// as do another pixel size and opening without resuming
+	const unsigned pixels[] = {3, PIXEL};
+	const bool resumes[] = {true, false};
+
+	for(unsigned r(0); r != 2; ++r) {
+		CHECK(store.open(PATH, KEY, PIXEL, false));
+		CHECK(store.append(W, H, &frames[0][0], 1, false));
+		CHECK(store.open(PATH, KEY, pixels[r], resumes[r]));
+		CHECK(store.size() == 0);
+	}
+}
+
+
+/**
+ * An export canceled or killed while a frame was written leaves its slot
+ * in the file but not counted, resumed without it. A file cut short is not
+ * resumed at all.
+ */
+void stopped(const std::vector<Bytes>& frames) {
+	const std::vector<Bytes> complete(frames.begin(), frames.begin() + 3);
+	uint64_t size(0);
+
+	{
+		FrameStore store;
+		CHECK(store.open(PATH, KEY, PIXEL, false));
+
+		for(unsigned i(0); i != 3; ++i)
+			CHECK(store.append(W, H, &frames[i][0], 1, true));
+
+		size = fileSize();
+	}
+
+	// the slot of a fourth frame, partly written
+	resize(size + size / 4);
+	std::fstream(PATH.c_str(), std::ios::in | std::ios::out |
+				 std::ios::binary).seekp(size).write("partial", 7);
+
+	FrameStore store;
+	CHECK(store.open(PATH, KEY, PIXEL, true));
+	CHECK(store.size() == 3 and holds(store, complete));
+
+	// and written again over
+	CHECK(store.append(W, H, &frames[2][0], 1, false));
+	CHECK(store.read(3, [&frames](const byte* const pixels) {
+		return Bytes(pixels, pixels + W * H * PIXEL) == frames[2];
+	}));
+	store.close();
+
+	resize(size - 1);
+	CHECK(store.open(PATH, KEY, PIXEL, true));
+	CHECK(store.size() == 0);
+}
+
+
+/// the pixels of each frame, read from the store
+bool holds(const FrameStore& store, const std::vector<Bytes>& frames) {
+	if(store.size() != frames.size())
+		return false;
+
+	for(unsigned i(0); i != frames.size(); ++i)
+		if(not store.read(i, [&frames, i](const byte* const pixels) {
+			return Bytes(pixels, pixels + W * H * PIXEL) == frames[i];
+		}))
+			return false;
+
+	return true;
+}
+
+
+bool same(const FrameStore::Record& record,
+		  const unsigned delay,
+		  const unsigned source,
+		  const unsigned frames,
+		  const bool keep)
+{
+	return record.delay == delay and record.source == source and
+		   record.frames == frames and (record.keep != 0) == keep;
+}
+
+
+uint64_t fileSize() {
+	std::ifstream in(PATH.c_str(), std::ios::binary | std::ios::ate);
+	return uint64_t(in.tellg());
+}
+
+
+/// truncates or extends the file
+void resize(const uint64_t size) {
+	CHECK(::truncate(PATH.c_str(), size) == 0);
+}
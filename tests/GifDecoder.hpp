@@ -0,0 +1,360 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef GIFDECODER_HPP
+#define GIFDECODER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+/**
+ * @file GifDecoder.hpp
+ * A plain GIF decoder, written from the specification, to read back what
+ * the encoders write, and the compositing of the frames as viewers show
+ * them.
+ */
+
+
+namespace test {
+
+
+typedef unsigned char byte;
+typedef std::vector<byte> Bytes;
+
+const unsigned MAX_BITS(12); // of the LZW codes
+
+
+/**
+ * @brief decodeImage reads the GIF table based image data at data[pos].
+ * @return whether the data is valid and 'pos' is past its terminator.
+ */
+inline bool decodeImage(const Bytes& data, std::size_t& pos, Bytes& indices) {
+	const unsigned MAX_CODES(1 << MAX_BITS);
+
+	if(pos == data.size())
+		return false;
+
+	const unsigned min_code_size(data[pos++]);
+
+	if(min_code_size < 2 or min_code_size > 8)
+		return false;
+
+	// the sub-blocks joined
+	Bytes codes;
+
+	for(;;) {
+		if(pos == data.size())
+			return false;
+
+		const unsigned size(data[pos++]);
+
+		if(size == 0)
+			break;
+
+		if(data.size() - pos < size)
+			return false;
+
+		const Bytes::const_iterator block(data.begin() + pos);
+		codes.insert(codes.end(), block, block + size);
+		pos += size;
+	}
+
+	const unsigned clear(1 << min_code_size);
+	const unsigned end(clear + 1);
+	std::vector<unsigned> prefixes(MAX_CODES);
+	std::vector<byte> suffixes(MAX_CODES);
+	std::vector<byte> firsts(MAX_CODES); // first index of each string
+	for(unsigned i(0); i != clear; ++i)
+		suffixes[i] = firsts[i] = byte(i);
+
+	unsigned size(min_code_size + 1);
+	unsigned next(clear + 2);
+	const unsigned NONE(~0u);
+	unsigned previous(NONE);
+	std::size_t bit(0);
+	Bytes string;
+	indices.clear();
+
+	for(;;) {
+		if(bit + size > codes.size() * 8)
+			return false; // no end code
+
+		unsigned code(0);
+		for(unsigned i(0); i != size; ++i, ++bit)
+			code |= ((codes[bit / 8] >> (bit % 8)) & 1) << i;
+
+		if(code == clear) {
+			size = min_code_size + 1;
+			next = clear + 2;
+			previous = NONE;
+			continue;
+		}
+
+		if(code == end)
+			return (bit + 7) / 8 == codes.size(); // nothing after it
+
+		if(previous == NONE) {
+			if(code >= clear)
+				return false;
+
+			indices.push_back(byte(code));
+			previous = code;
+			continue;
+		}
+
+		if(code > next or (code == next and next == MAX_CODES))
+			return false;
+
+		const unsigned first(code < next ? firsts[code] : firsts[previous]);
+
+		if(next != MAX_CODES) {
+			prefixes[next] = previous;
+			suffixes[next] = first;
+			firsts[next] = firsts[previous];
+			++next;
+
+			if(next == (1u << size) and size < MAX_BITS)
+				++size;
+		}
+
+		string.clear();
+		for(unsigned c(code); c >= clear; c = prefixes[c])
+			string.push_back(suffixes[c]);
+		string.push_back(firsts[code]);
+
+		indices.insert(indices.end(), string.rbegin(), string.rend());
+		previous = code;
+	}
+}
+
+
+/// an image with its graphic control extension
+struct Frame {
+	unsigned x, y, w, h;
+	unsigned delay; // in 1/100 s
+	unsigned disposal;
+	bool transparent;
+	byte transparentIndex;
+	Bytes table; // RGB, empty for the global color table
+	Bytes indices;
+};
+
+
+struct Gif {
+	unsigned width, height;
+	Bytes table; // the global color table, RGB
+	bool loops; // forever, from the NETSCAPE2.0 extension
+	std::vector<Frame> frames;
+};
+
+
+/// little endian
+inline unsigned get16(const Bytes& data, const std::size_t pos) {
+	return data[pos] | data[pos + 1] << 8;
+}
+
+
+/// the sub-blocks of an extension, skipped
+inline bool skipBlocks(const Bytes& data, std::size_t& pos) {
+	for(;;) {
+		if(pos == data.size())
+			return false;
+
+		const unsigned size(data[pos++]);
+
+		if(size == 0)
+			return true;
+
+		if(data.size() - pos < size)
+			return false;
+
+		pos += size;
+	}
+}
+
+
+/// the color table following a packed field, if its flag is set
+inline bool readTable(const Bytes& data,
+					  std::size_t& pos,
+					  const byte packed,
+					  Bytes& table)
+{
+	table.clear();
+
+	if(not (packed & 0x80))
+		return true;
+
+	const std::size_t size(3 << ((packed & 0x07) + 1));
+
+	if(data.size() - pos < size)
+		return false;
+
+	table.assign(data.begin() + pos, data.begin() + pos + size);
+	pos += size;
+	return true;
+}
+
+
+/**
+ * @brief decode reads a whole GIF89a file of non interlaced images.
+ * @return whether it is valid up to its trailer, with nothing after it.
+ */
+inline bool decode(const Bytes& data, Gif& gif) {
+	const byte EXTENSION(0x21), IMAGE(0x2c), TRAILER(0x3b);
+	const byte GRAPHIC_CONTROL(0xf9), APPLICATION(0xff);
+
+	if(data.size() < 13 or std::string(data.begin(), data.begin() + 6) !=
+						   "GIF89a")
+		return false;
+
+	gif.width = get16(data, 6);
+	gif.height = get16(data, 8);
+	gif.loops = false;
+	gif.frames.clear();
+	std::size_t pos(13);
+
+	if(not readTable(data, pos, data[10], gif.table))
+		return false;
+
+	Frame frame = Frame();
+
+	while(pos != data.size()) {
+		const byte block(data[pos++]);
+
+		if(block == TRAILER)
+			return pos == data.size();
+
+		if(block == EXTENSION) {
+			if(pos == data.size())
+				return false;
+
+			const byte label(data[pos++]);
+
+			if(label == GRAPHIC_CONTROL) {
+				if(data.size() - pos < 6 or data[pos] != 4 or
+				   data[pos + 5] != 0)
+					return false;
+
+				frame.disposal = data[pos + 1] >> 2 & 0x07;
+				frame.transparent = data[pos + 1] & 0x01;
+				frame.delay = get16(data, pos + 2);
+				frame.transparentIndex = data[pos + 4];
+				pos += 6;
+				continue;
+			}
+
+			if(label == APPLICATION and data.size() - pos >= 12 and
+			   std::string(data.begin() + pos + 1, data.begin() + pos + 12) ==
+			   "NETSCAPE2.0")
+				gif.loops = true;
+
+			if(not skipBlocks(data, pos))
+				return false;
+			continue;
+		}
+
+		if(block != IMAGE or data.size() - pos < 9)
+			return false;
+
+		frame.x = get16(data, pos);
+		frame.y = get16(data, pos + 2);
+		frame.w = get16(data, pos + 4);
+		frame.h = get16(data, pos + 6);
+		const byte packed(data[pos + 8]);
+		pos += 9;
+
+		if(packed & 0x40 or frame.x + frame.w > gif.width or
+		   frame.y + frame.h > gif.height) // interlaced or outside
+			return false;
+
+		if(not readTable(data, pos, packed, frame.table) or
+		   not decodeImage(data, pos, frame.indices) or
+		   frame.indices.size() != frame.w * frame.h)
+			return false;
+
+		gif.frames.push_back(frame);
+		frame = Frame();
+	}
+
+	return false; // no trailer
+}
+
+
+/// the whole file at 'path'
+inline Bytes readFile(const std::string& path) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	return Bytes(std::istreambuf_iterator<char>(in),
+				 std::istreambuf_iterator<char>());
+}
+
+
+/**
+ * @brief composite draws the frames over each other, as viewers show them,
+ * and gives the RGB canvas after each one. The canvas starts black.
+ * Only the frames left in place (disposal 0 or 1) are handled.
+ * @return false if a frame is disposed of otherwise or uses an index past
+ * its color table.
+ */
+inline bool composite(const Gif& gif, std::vector<Bytes>& canvases) {
+	Bytes canvas(gif.width * gif.height * 3, 0);
+	canvases.clear();
+
+	for(std::size_t f(0); f != gif.frames.size(); ++f) {
+		const Frame& frame(gif.frames[f]);
+		const Bytes& table(frame.table.empty()? gif.table : frame.table);
+
+		if(frame.disposal > 1)
+			return false;
+
+		for(unsigned y(0); y != frame.h; ++y)
+			for(unsigned x(0); x != frame.w; ++x) {
+				const byte index(frame.indices[y * frame.w + x]);
+
+				if(frame.transparent and index == frame.transparentIndex)
+					continue;
+
+				if(index * 3u >= table.size())
+					return false;
+
+				const std::size_t i((frame.y + y) * gif.width + frame.x + x);
+				std::copy(&table[index * 3], &table[index * 3] + 3,
+						  &canvas[i * 3]);
+			}
+
+		canvases.push_back(canvas);
+	}
+
+	return true;
+}
+
+
+} // namespace test
+
+
+#endif // GIFDECODER_HPP
@@ -0,0 +1,278 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "GifDecoder.hpp"
+#include "GifWriter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+
+using test::byte;
+using test::Bytes;
+typedef std::vector<Bytes> Frames;
+
+const unsigned W(80), H(64), BLOCK(8);
+const std::string PATH("GifWriterTest.gif");
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+Bytes colors(const unsigned count, const int shift = 0);
+
+Bytes blocks(const Bytes& colors);
+
+void fill(Bytes& frame,
+		  const unsigned x,
+		  const unsigned y,
+		  const unsigned w,
+		  const unsigned h,
+		  const byte* rgb);
+
+Bytes toFormat(const Bytes& rgb, const AnimationWriter::PixelFormat format);
+
+void roundTrip(const AnimationWriter::PixelFormat format);
+
+void repeats(const Dither::Method dither);
+
+
+/* *****************************************************************************
+ * Written, decoded and composited frames show what was given.
+ * ****************************************************************************/
+int main() {
+	std::srand(1);
+
+	roundTrip(AnimationWriter::RGBA);
+	roundTrip(AnimationWriter::RGB);
+	repeats(Dither::ORDERED);
+	repeats(Dither::FLOYD_STEINBERG);
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/**
+ * Frames of few colors, far apart, fit their palette exactly: without
+ * dithering, the composited frames are the input. They cover a frame that
+ * changes a rectangle, one that changes nothing, a palette updated to colors
+ * that moved, repeats of kept frames of both palettes and the delays.
+ */
+void roundTrip(const AnimationWriter::PixelFormat format) {
+	Frames frames; // RGB, as composited
+	std::vector<unsigned> delays;
+
+	// the first palette, on the whole canvas
+	frames.push_back(blocks(colors(40)));
+	delays.push_back(4);
+
+	// a rectangle changes
+	frames.push_back(frames.back());
+	fill(frames.back(), 20, 12, 15, 9, &colors(6)[5 * 3]);
+	delays.push_back(5);
+
+	// nothing changes
+	frames.push_back(frames.back());
+	delays.push_back(6);
+
+	// the colors move, as in a morph, and the palette follows them, kept
+	frames.push_back(blocks(colors(40, 8)));
+	delays.push_back(7);
+
+	// then a few pixels
+	frames.push_back(frames.back());
+	fill(frames.back(), 79, 63, 1, 1, &frames[3][0]);
+	fill(frames.back(), 3, 50, 2, 1, &frames[3][0]);
+	delays.push_back(8);
+
+	{
+		GifWriter writer(format, Dither::NONE);
+		CHECK(writer.open(PATH));
+
+		for(unsigned f(0); f != frames.size(); ++f) {
+			const Bytes bytes(toFormat(frames[f], format));
+			CHECK(writer.appendFrame(W, H, &bytes[0], delays[f], f == 1 or
+																  f == 3));
+		}
+
+		// the kept frames, of the first and second palettes
+		CHECK(writer.repeatFrame(1, 9));
+		frames.push_back(frames[1]);
+		delays.push_back(9);
+		CHECK(writer.repeatFrame(3, 10));
+		frames.push_back(frames[3]);
+		delays.push_back(10 + 11);
+		CHECK(writer.extendFrame(11));
+
+		// frames not kept or not there are not repeated
+		CHECK(not writer.repeatFrame(0, 1));
+		CHECK(not writer.repeatFrame(7, 1));
+		CHECK(writer.finish());
+	}
+
+	CHECK(not std::ifstream((PATH + ".kept").c_str()));
+
+	test::Gif gif;
+	Frames canvases;
+
+	if(not CHECK(test::decode(test::readFile(PATH), gif)) or
+	   not CHECK(test::composite(gif, canvases)))
+		return;
+
+	std::remove(PATH.c_str());
+	CHECK(gif.width == W and gif.height == H and gif.loops);
+
+	if(not CHECK(canvases.size() == frames.size()))
+		return;
+
+	for(unsigned f(0); f != frames.size(); ++f) {
+		CHECK(canvases[f] == frames[f]);
+		CHECK(gif.frames[f].delay == delays[f]);
+	}
+
+	// the first frame covers the canvas with the global color table
+	const test::Frame& first(gif.frames[0]);
+	CHECK(first.w == W and first.h == H and first.table.empty());
+
+	// then only the rectangles that change, transparent pixels in them
+	const test::Frame& rect(gif.frames[1]);
+	CHECK(rect.x == 20 and rect.y == 12 and rect.w == 15 and rect.h == 9);
+	CHECK(gif.frames[2].w * gif.frames[2].h == 1);
+	const test::Frame& pixels(gif.frames[4]);
+	CHECK(pixels.x == 3 and pixels.y == 50 and pixels.w == 77 and
+		  pixels.h == 14 and pixels.transparent);
+
+	// the second palette is a local color table
+	CHECK(not gif.frames[3].table.empty());
+	CHECK(gif.frames[5].table.empty() and not gif.frames[6].table.empty());
+}
+
+
+/**
+ * Dithered frames are not the input, but a repeat shows what the kept frame
+ * showed, whatever was drawn in between.
+ */
+void repeats(const Dither::Method dither) {
+	Frames frames;
+
+	for(unsigned f(0); f != 4; ++f)
+		frames.push_back(test::image(W, H));
+
+	{
+		GifWriter writer(AnimationWriter::RGBA, dither);
+		CHECK(writer.open(PATH));
+
+		for(unsigned f(0); f != frames.size(); ++f)
+			CHECK(writer.appendFrame(W, H, &frames[f][0], 2, f % 2 == 0));
+
+		CHECK(writer.repeatFrame(2, 2));
+		CHECK(writer.repeatFrame(0, 2));
+		CHECK(writer.repeatFrame(4, 2)); // a repeat of a repeat
+		CHECK(writer.finish());
+	}
+
+	test::Gif gif;
+	Frames canvases;
+
+	if(not CHECK(test::decode(test::readFile(PATH), gif)) or
+	   not CHECK(test::composite(gif, canvases)))
+		return;
+
+	std::remove(PATH.c_str());
+
+	if(not CHECK(canvases.size() == 7))
+		return;
+
+	CHECK(canvases[4] == canvases[2]);
+	CHECK(canvases[5] == canvases[0]);
+	CHECK(canvases[6] == canvases[2]);
+	CHECK(canvases[1] != canvases[0]);
+}
+
+
+/// 'count' RGB colors of a 8 x 8 x 8 grid, moved by 'shift'
+Bytes colors(const unsigned count, const int shift) {
+	Bytes rgb;
+
+	for(unsigned i(0); i != count; ++i) {
+		rgb.push_back(16 + 32 * (i % 8) + shift);
+		rgb.push_back(16 + 32 * (i / 8 % 8) + shift);
+		rgb.push_back(16 + 32 * (i / 64 % 8) + shift);
+	}
+
+	return rgb;
+}
+
+
+/// an RGB frame of BLOCK x BLOCK squares of 'colors', in turn
+Bytes blocks(const Bytes& colors) {
+	const unsigned count(colors.size() / 3);
+	Bytes frame(W * H * 3);
+
+	for(unsigned y(0); y != H / BLOCK; ++y)
+		for(unsigned x(0); x != W / BLOCK; ++x) {
+			const unsigned color((y * W / BLOCK + x) % count);
+			fill(frame, x * BLOCK, y * BLOCK, BLOCK, BLOCK,
+				 &colors[color * 3]);
+		}
+
+	return frame;
+}
+
+
+/// the rectangle of an RGB frame to 'rgb'
+void fill(Bytes& frame,
+		  const unsigned x,
+		  const unsigned y,
+		  const unsigned w,
+		  const unsigned h,
+		  const byte* const rgb)
+{
+	for(unsigned j(y); j != y + h; ++j)
+		for(unsigned i(x); i != x + w; ++i)
+			std::copy(rgb, rgb + 3, &frame[(j * W + i) * 3]);
+}
+
+
+/// an RGB frame as appendFrame takes it
+Bytes toFormat(const Bytes& rgb, const AnimationWriter::PixelFormat format) {
+	if(format == AnimationWriter::RGB)
+		return rgb;
+
+	Bytes rgba(W * H * 4);
+
+	for(unsigned i(0); i != W * H; ++i) {
+		std::copy(&rgb[i * 3], &rgb[i * 3] + 3, &rgba[i * 4]);
+		rgba[i * 4 + 3] = 0xff;
+	}
+
+	return rgba;
+}
@@ -0,0 +1,109 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "GifDecoder.hpp"
+#include "LzwEncoder.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+
+using test::byte;
+using test::Bytes;
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void roundTrip(LzwEncoder& encoder,
+			   const Bytes& indices,
+			   const unsigned min_code_size);
+
+
+/* *****************************************************************************
+ * Encode and decode round trips.
+ * ****************************************************************************/
+int main() {
+	LzwEncoder encoder;
+	std::srand(1);
+
+	for(unsigned bits(2); bits <= 8; ++bits) {
+		const unsigned colors(1 << bits);
+
+		// none, one and two pixels
+		roundTrip(encoder, Bytes(), bits);
+		roundTrip(encoder, Bytes(1, colors - 1), bits);
+		roundTrip(encoder, Bytes(2, 1), bits);
+
+		// a run, its codes are used as soon as they are made (KwKwK)
+		roundTrip(encoder, Bytes(100000, 1), bits);
+
+		// noise fills the table, which is cleared many times
+		Bytes noise(200000);
+		for(std::size_t i(0); i != noise.size(); ++i)
+			noise[i] = std::rand() % colors;
+		roundTrip(encoder, noise, bits);
+
+		// gradients, as dithered images
+		Bytes ramp(150000);
+		for(std::size_t i(0); i != ramp.size(); ++i)
+			ramp[i] = (i * 7 / 13 + (std::rand() % 3 == 0)) % colors;
+		roundTrip(encoder, ramp, bits);
+	}
+
+	// the data is appended, as after a GIF image descriptor
+	const Bytes indices(1000, 3);
+	Bytes data(5, 0xAA);
+	encoder.encode(&indices[0], indices.size(), 2, data);
+	std::size_t pos(5);
+	Bytes decoded;
+	CHECK(test::decodeImage(data, pos, decoded) and decoded == indices);
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+
+
+void roundTrip(LzwEncoder& encoder,
+			   const Bytes& indices,
+			   const unsigned min_code_size)
+{
+	Bytes data;
+	encoder.encode(indices.empty() ? 0 : &indices[0], indices.size(),
+				   min_code_size, data);
+
+	std::size_t pos(0);
+	Bytes decoded;
+
+	if(not CHECK(test::decodeImage(data, pos, decoded)))
+		return;
+
+	CHECK(pos == data.size());
+	CHECK(decoded == indices);
+}
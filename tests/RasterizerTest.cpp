@@ -0,0 +1,110 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "Rasterizer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+bool same(const Rasterizer::Spans& a, const Rasterizer::Spans& b);
+
+
+/* *****************************************************************************
+ * Every level gives the spans of the scalar rasterizer, for triangles of
+ * every size and winding, partly outside the target and clipped.
+ * ****************************************************************************/
+int main() {
+	const std::vector<SimdLevel> levels(test::levels());
+	const int ONE(Rasterizer::SUBPIXEL_ONE);
+	std::srand(1);
+
+	for(unsigned i(0); i != 2000; ++i) {
+		const unsigned width(1 + std::rand() % 300);
+		const unsigned height(1 + std::rand() % 300);
+		const int scale(i % 4 == 0 ? 8 : 400); // tiny ones too
+
+		Rasterizer::Point p[3];
+		for(unsigned k(0); k != 3; ++k) {
+			p[k].x = std::rand() % (scale * ONE) - (i % 3) * 50 * ONE;
+			p[k].y = std::rand() % (scale * ONE) - (i % 5) * 20 * ONE;
+		}
+
+		const int x0(std::rand() % width), y0(std::rand() % height);
+		const int x1(x0 + 1 + std::rand() % (width - x0));
+		const int y1(y0 + 1 + std::rand() % (height - y0));
+
+		const Rasterizer scalar(SIMD_SCALAR);
+		Rasterizer::Spans expected, clipped;
+		const unsigned n(scalar.triangle(p[0], p[1], p[2], width, height,
+										 expected));
+		scalar.triangle(p[0], p[1], p[2], x0, y0, x1, y1, clipped);
+
+		for(unsigned l(1); l < levels.size(); ++l) {
+			const Rasterizer rasterizer(levels[l]);
+			Rasterizer::Spans spans;
+
+			CHECK(rasterizer.triangle(p[0], p[1], p[2], width, height,
+									  spans) == n);
+			CHECK(same(spans, expected));
+
+			spans.clear();
+			rasterizer.triangle(p[0], p[1], p[2], x0, y0, x1, y1, spans);
+			CHECK(same(spans, clipped));
+		}
+
+		// the clipped spans are the whole ones cut to the rectangle
+		Rasterizer::Spans cut;
+		for(unsigned s(0); s != expected.size(); ++s) {
+			const Rasterizer::Span& span(expected[s]);
+			const int from(std::max(span.x0, x0)), to(std::min(span.x1, x1));
+
+			if(y0 <= span.y and span.y < y1 and from < to)
+				cut.push_back(Rasterizer::Span(span.y, from, to));
+		}
+		CHECK(same(clipped, cut));
+	}
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+bool same(const Rasterizer::Spans& a, const Rasterizer::Spans& b) {
+	if(a.size() != b.size())
+		return false;
+
+	for(unsigned i(0); i != a.size(); ++i)
+		if(a[i].y != b[i].y or a[i].x0 != b[i].x0 or a[i].x1 != b[i].x1)
+			return false;
+
+	return true;
+}
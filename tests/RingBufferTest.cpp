@@ -0,0 +1,157 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "RingBuffer.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+typedef RingBuffer<unsigned> Ring;
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void order(const unsigned capacity, const unsigned writers);
+
+void backpressure();
+
+void close();
+
+
+/* *****************************************************************************
+ * Items are read in ticket order, writers wait for their slot and close()
+ * wakes every wait.
+ * ****************************************************************************/
+int main() {
+	const unsigned capacities[] = {1, 2, 5};
+	const unsigned writers[] = {1, 2, 4};
+
+	for(unsigned c(0); c != 3; ++c)
+		for(unsigned w(0); w != 3; ++w)
+			order(capacities[c], writers[w]);
+
+	backpressure();
+	close();
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/// many times around the ring, written out of order
+void order(const unsigned capacity, const unsigned writers) {
+	const unsigned COUNT(1000);
+	Ring ring(capacity);
+	std::vector<std::thread> threads;
+
+	for(unsigned i(0); i != writers; ++i)
+		threads.push_back(std::thread([&ring, COUNT]() {
+			for(Ring::Ticket ticket(ring.ticket()); ticket < COUNT;
+				ticket = ring.ticket()) {
+				unsigned* const slot(ring.beginWrite(ticket));
+				*slot = unsigned(ticket * 3);
+				ring.endWrite(ticket);
+			}
+		}));
+
+	unsigned in_order(0);
+
+	for(unsigned i(0); i != COUNT; ++i) {
+		const unsigned* const slot(ring.beginRead(i));
+		in_order += slot != 0 and *slot == i * 3;
+		ring.endRead(i);
+	}
+
+	for(unsigned i(0); i != threads.size(); ++i)
+		threads[i].join();
+
+	CHECK(in_order == COUNT);
+	CHECK(not ring.closed());
+}
+
+
+/// a writer a capacity ahead of the reader waits until the slot is read
+void backpressure() {
+	Ring ring(1);
+	CHECK(ring.capacity() == 1);
+
+	*ring.beginWrite(ring.ticket()) = 10;
+	ring.endWrite(0);
+
+	std::atomic<bool> written(false);
+	std::thread writer([&ring, &written]() {
+		const Ring::Ticket ticket(ring.ticket());
+		unsigned* const slot(ring.beginWrite(ticket));
+		*slot = 11;
+		written = true;
+		ring.endWrite(ticket);
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(not written);
+
+	CHECK(*ring.beginRead(0) == 10);
+	ring.endRead(0);
+	CHECK(*ring.beginRead(1) == 11);
+	ring.endRead(1);
+
+	writer.join();
+	CHECK(written);
+}
+
+
+/// waiting writers and reader return null once closed, and so do new waits
+void close() {
+	Ring ring(1);
+	ring.beginWrite(ring.ticket());
+	ring.endWrite(0);
+
+	unsigned dummy(0);
+	unsigned* write(&dummy);
+	const unsigned* read(&dummy);
+
+	std::thread writer([&ring, &write]() {
+		write = ring.beginWrite(ring.ticket()); // slot 0 not read yet
+	});
+	std::thread reader([&ring, &read]() {
+		read = ring.beginRead(2); // never written
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	ring.close();
+	writer.join();
+	reader.join();
+
+	CHECK(ring.closed());
+	CHECK(write == 0);
+	CHECK(read == 0);
+	CHECK(ring.beginWrite(5) == 0);
+	CHECK(ring.beginRead(5) == 0);
+}
@@ -0,0 +1,85 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "Sampler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+
+typedef unsigned char byte;
+typedef std::vector<byte> Bytes;
+
+
+/* *****************************************************************************
+ * Every level and layout samples as the scalar interleaved sampler, along
+ * spans in any direction, in and out of the image.
+ * ****************************************************************************/
+int main() {
+	const std::vector<SimdLevel> levels(test::levels());
+	std::srand(1);
+
+	const unsigned W(37), H(29), N(100);
+	const Bytes bits(test::image(W, H));
+	const ConstImageView img(&bits[0], W, H);
+	const Sampler expected(img, Sampler::INTERLEAVED, SIMD_SCALAR);
+
+	std::vector<Sampler> samplers;
+	for(unsigned l(0); l != levels.size(); ++l) {
+		samplers.push_back(Sampler(img, Sampler::INTERLEAVED, levels[l]));
+		samplers.push_back(Sampler(img, Sampler::PLANAR, levels[l]));
+	}
+
+	Bytes want(N * 4), got(N * 4);
+	const int ONE(Sampler::ONE);
+
+	for(unsigned i(0); i != 2000; ++i) {
+		const int u(std::rand() % (60 * ONE) - 10 * ONE);
+		const int v(std::rand() % (50 * ONE) - 10 * ONE);
+		const int du(std::rand() % (2 * ONE) - ONE);
+		const int dv(std::rand() % (2 * ONE) - ONE);
+		const unsigned n(1 + std::rand() % N);
+
+		expected.span(u, v, du, dv, n, &want[0]);
+
+		for(unsigned s(0); s != samplers.size(); ++s) {
+			samplers[s].span(u, v, du, dv, n, &got[0]);
+			CHECK(std::equal(want.begin(), want.begin() + n * 4, got.begin()));
+		}
+	}
+
+	// texel centers give the texels, outside the edge ones
+	for(unsigned y(0); y != H; ++y)
+		for(unsigned x(0); x != W; ++x) {
+			expected.span(x * ONE, y * ONE, 0, 0, 1, &want[0]);
+			CHECK(std::equal(want.begin(), want.begin() + 4, img.pixel(x, y)));
+		}
+
+	expected.span(-5 * ONE, (H + 3) * ONE, 0, 0, 1, &want[0]);
+	CHECK(std::equal(want.begin(), want.begin() + 4, img.pixel(0, H - 1)));
+
+	return test::failures();
+}
@@ -0,0 +1,281 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "SoftRenderer.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+
+typedef unsigned char byte;
+typedef std::vector<byte> Bytes;
+
+// the most a channel may differ from the reference: the samplers weights
+// are in fixed point and GL rounds the src pass before blending dst on it
+const int TOLERANCE(2);
+
+
+/* *****************************************************************************
+ * Utilities forward declaration.
+ * ****************************************************************************/
+void reference(const Mesh& src_mesh,
+			   const Mesh& dst_mesh,
+			   const Faces& faces,
+			   const ConstImageView& src,
+			   const ConstImageView& dst,
+			   const float t,
+			   const ImageView& target);
+
+void sample(const ConstImageView& img, const float u, const float v,
+			float* const out);
+
+int compare(const Bytes& a, const Bytes& b);
+
+Mesh scaled(const Mesh& msh, const float margin);
+
+void levels();
+
+void threads();
+
+
+/* *****************************************************************************
+ * SoftRenderer against a per pixel drawBlended, as GL draws it.
+ * ****************************************************************************/
+int main() {
+	std::srand(1);
+
+	const unsigned W(150), H(110);
+	const Bytes src_bits(test::image(64, 48)), dst_bits(test::image(33, 70));
+	const ConstImageView src(&src_bits[0], 64, 48), dst(&dst_bits[0], 33, 70);
+	const ConstImageView none;
+
+	// neither folds, and both leave a border of the target uncovered, with
+	// no pixel center on its edge since fill rules are not modelled
+	Faces faces;
+	const Mesh src_mesh(scaled(test::mesh(9, 0.03f, faces), 0.1f));
+	const Mesh dst_mesh(scaled(test::mesh(9, 0.03f, faces), 0.06f));
+	const float ts[] = {0.0f, 0.3f, 0.5f, 0.9f, 1.0f};
+	const ConstImageView images[][2] = {{src, dst}, {src, none}, {none, dst}};
+
+	for(unsigned i(0); i != 3; ++i)
+		for(unsigned j(0); j != 5; ++j) {
+			Bytes expected(test::image(W, H)), frame(expected);
+
+			reference(src_mesh, dst_mesh, faces, images[i][0], images[i][1],
+					  ts[j], ImageView(&expected[0], W, H));
+			SoftRenderer().drawBlended(src_mesh, dst_mesh, faces,
+									   images[i][0], images[i][1], ts[j],
+									   ImageView(&frame[0], W, H));
+
+			if(not CHECK(compare(frame, expected) <= TOLERANCE))
+				std::cerr << "images " << i << " t " << ts[j] << std::endl;
+		}
+
+	levels();
+	threads();
+
+
+	return test::failures();
+}
+
+
+/* *****************************************************************************
+ * Utilities implementation.
+ * ****************************************************************************/
+/**
+ * @brief reference draws as ::drawBlended does, in floating point, one pixel
+ * center at a time: src with blending disabled, then dst blended with a
+ * constant alpha of t, through bilinear clamped textures flipped in y.
+ */
+void reference(const Mesh& src_mesh,
+			   const Mesh& dst_mesh,
+			   const Faces& faces,
+			   const ConstImageView& src,
+			   const ConstImageView& dst,
+			   const float t,
+			   const ImageView& target)
+{
+	Mesh msh;
+	interpolate(src_mesh, dst_mesh, t, msh);
+
+	const ConstImageView* const layers[] = {&src, &dst};
+	const Mesh* const coords[] = {&src_mesh, &dst_mesh};
+
+	for(unsigned layer(0); layer != 2; ++layer) {
+		const ConstImageView& img(*layers[layer]);
+		const Mesh& tc(*coords[layer]);
+
+		if(img.null())
+			continue;
+
+		for(unsigned y(0); y != target.height; ++y)
+			for(unsigned x(0); x != target.width; ++x) {
+				const float px((x + 0.5f) / target.width);
+				const float py(1.0f - (y + 0.5f) / target.height);
+
+				for(unsigned i(0); i != faces.size(); ++i) {
+					const vec2& a(msh[faces[i].a]);
+					const vec2& b(msh[faces[i].b]);
+					const vec2& c(msh[faces[i].c]);
+					const float area((b.x - a.x) * (c.y - a.y) -
+									 (c.x - a.x) * (b.y - a.y));
+					const float wb(((px - a.x) * (c.y - a.y) -
+									(c.x - a.x) * (py - a.y)) / area);
+					const float wc(((b.x - a.x) * (py - a.y) -
+									(px - a.x) * (b.y - a.y)) / area);
+					const float wa(1.0f - wb - wc);
+
+					if(wa < 0.0f or wb < 0.0f or wc < 0.0f)
+						continue;
+
+					const vec2 uv(tc[faces[i].a] * wa + tc[faces[i].b] * wb +
+								  tc[faces[i].c] * wc);
+					float texel[4];
+					sample(img, uv.x * img.width - 0.5f,
+						   (1.0f - uv.y) * img.height - 0.5f, texel);
+
+					byte* const out(target.pixel(x, y));
+					const float alpha(layer == 0? 1.0f : t);
+
+					for(unsigned k(0); k != 4; ++k)
+						out[k] = byte(std::floor(texel[k] * alpha +
+												 out[k] * (1.0f - alpha) +
+												 0.5f));
+					break;
+				}
+			}
+	}
+}
+
+
+/// bilinear sample at texel (u, v), texel centers at integers, clamped
+void sample(const ConstImageView& img, const float u, const float v,
+			float* const out)
+{
+	const float x(std::floor(u)), y(std::floor(v));
+	const float fx(u - x), fy(v - y);
+	const int xs[] = {int(x), int(x) + 1};
+	const int ys[] = {int(y), int(y) + 1};
+	const float wx[] = {1.0f - fx, fx};
+	const float wy[] = {1.0f - fy, fy};
+
+	std::fill(out, out + 4, 0.0f);
+
+	for(unsigned j(0); j != 2; ++j)
+		for(unsigned i(0); i != 2; ++i) {
+			const int cx(std::min(std::max(xs[i], 0), int(img.width) - 1));
+			const int cy(std::min(std::max(ys[j], 0), int(img.height) - 1));
+			const byte* const p(img.pixel(cx, cy));
+
+			for(unsigned k(0); k != 4; ++k)
+				out[k] += p[k] * wx[i] * wy[j];
+		}
+}
+
+
+/// the largest difference of a channel
+int compare(const Bytes& a, const Bytes& b) {
+	int most(0);
+
+	for(unsigned i(0); i != a.size(); ++i)
+		most = std::max(most, std::abs(int(a[i]) - int(b[i])));
+
+	return most;
+}
+
+
+/// every level draws the frames of the scalar one, folds included
+void levels() {
+	const std::vector<SimdLevel> tested(test::levels());
+	const unsigned W(150), H(110);
+	const Bytes src_bits(test::image(64, 48)), dst_bits(test::image(33, 70));
+	const ConstImageView src(&src_bits[0], 64, 48), dst(&dst_bits[0], 33, 70);
+
+	Faces faces;
+	const Mesh src_mesh(test::mesh(9, 0.2f, faces));
+	const Mesh dst_mesh(test::mesh(9, 0.05f, faces));
+	const float ts[] = {0.0f, 0.3f, 1.0f};
+
+	for(unsigned i(0); i != 3; ++i) {
+		Bytes expected(W * H * 4, 0);
+		SoftRenderer(SIMD_SCALAR).drawBlended(src_mesh, dst_mesh, faces,
+											  src, dst, ts[i],
+											  ImageView(&expected[0], W, H));
+
+		for(unsigned l(1); l < tested.size(); ++l) {
+			Bytes frame(W * H * 4, 0);
+			SoftRenderer(tested[l]).drawBlended(src_mesh, dst_mesh, faces,
+												src, dst, ts[i],
+												ImageView(&frame[0], W, H));
+			CHECK(frame == expected);
+		}
+	}
+}
+
+
+/// tiles rendered on any number of threads give the same frame
+void threads() {
+	const unsigned W(300), H(200); // several tiles each way
+	const Bytes src_bits(test::image(64, 48)), dst_bits(test::image(33, 70));
+	const ConstImageView src(&src_bits[0], 64, 48), dst(&dst_bits[0], 33, 70);
+
+	Faces faces;
+	const Mesh src_mesh(test::mesh(12, 0.2f, faces)); // folds over itself
+	const Mesh dst_mesh(test::mesh(12, 0.05f, faces));
+
+	Bytes expected(W * H * 4, 0);
+	SoftRenderer().drawBlended(src_mesh, dst_mesh, faces, src, dst, 0.4f,
+							   ImageView(&expected[0], W, H));
+
+	const unsigned sizes[] = {1, 2, 3, 8};
+
+	for(unsigned s(0); s != 4; ++s) {
+		ThreadPool pool(sizes[s]);
+		SoftRenderer renderer;
+		renderer.setThreadPool(&pool);
+
+		// twice, the renderer reuses its bins
+		for(unsigned i(0); i != 2; ++i) {
+			Bytes frame(W * H * 4, 0);
+			renderer.drawBlended(src_mesh, dst_mesh, faces, src, dst, 0.4f,
+								 ImageView(&frame[0], W, H));
+			CHECK(frame == expected);
+		}
+	}
+}
+
+
+/// 'msh' moved into [margin, 1 - margin]
+Mesh scaled(const Mesh& msh, const float margin) {
+	Mesh out(msh.size());
+
+	for(unsigned i(0); i != msh.size(); ++i)
+		out[i] = msh[i] * (1.0f - 2.0f * margin) + vec2(margin, margin);
+
+	return out;
+}
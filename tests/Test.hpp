@@ -0,0 +1,137 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include "simd.hpp"
+#include "utils.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+
+/**
+ * @file Test.hpp
+ * The checks of the tests. A failed check is reported and the test goes
+ * on, main() returns failures() so that ctest tells it failed.
+ * The inputs are made from std::rand(), seeded by each test.
+ */
+
+
+#define CHECK(condition) \
+	test::check((condition), #condition, __FILE__, __LINE__)
+
+
+namespace test {
+
+
+inline unsigned& failureCount() {
+	static unsigned count(0);
+	return count;
+}
+
+
+inline bool check(const bool passed,
+				  const char* const condition,
+				  const char* const file,
+				  const int line)
+{
+	if(not passed) {
+		std::cerr << file << ":" << line << ": failed " << condition
+				  << std::endl;
+		++failureCount();
+	}
+	return passed;
+}
+
+
+/// the exit status of a test
+inline int failures() {
+	return failureCount() == 0 ? 0 : 1;
+}
+
+
+/// the SIMD levels this cpu runs, scalar first
+inline std::vector<SimdLevel> levels() {
+	const SimdLevel best(simdLevel());
+	std::vector<SimdLevel> runs(1, SIMD_SCALAR);
+
+	if(best == SIMD_NEON_LEVEL)
+		runs.push_back(best);
+	else
+		for(int level(SIMD_SSE2); level <= best; ++level)
+			runs.push_back(SimdLevel(level));
+
+	return runs;
+}
+
+
+/// RGBA8888 noise with smooth gradients, so filtering has work to do
+inline std::vector<unsigned char> image(const unsigned width,
+										const unsigned height)
+{
+	std::vector<unsigned char> bits(width * height * 4);
+
+	for(unsigned y(0); y != height; ++y)
+		for(unsigned x(0); x != width; ++x) {
+			unsigned char* const p(&bits[(y * width + x) * 4]);
+			p[0] = x * 255 / width;
+			p[1] = y * 255 / height;
+			p[2] = std::rand() % 256;
+			p[3] = 255;
+		}
+
+	return bits;
+}
+
+
+/**
+ * @brief mesh a n x n grid over [0, 1] with its inner points moved by up to
+ * 'jitter', past their neighbours when it is above 1 / (n - 1).
+ */
+inline Mesh mesh(const unsigned n, const float jitter, Faces& faces) {
+	Mesh msh(n * n);
+
+	for(unsigned y(0); y != n; ++y)
+		for(unsigned x(0); x != n; ++x) {
+			vec2 p(float(x) / (n - 1), float(y) / (n - 1));
+
+			if(x != 0 and y != 0 and x != n - 1 and y != n - 1) {
+				p.x += jitter * (std::rand() * 2.0f / RAND_MAX - 1.0f);
+				p.y += jitter * (std::rand() * 2.0f / RAND_MAX - 1.0f);
+			}
+			msh[y * n + x] = p;
+		}
+
+	faces.clear();
+	generateTriangles(n - 1, n - 1, faces);
+	return msh;
+}
+
+
+} // namespace test
+
+
+#endif // TEST_HPP
@@ -0,0 +1,72 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (C) 2013 Paulo Silva <paulo.jnkml@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "Test.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+/* *****************************************************************************
+ * Every item is run once, by a worker in [0, size()), for any size.
+ * ****************************************************************************/
+int main() {
+	const unsigned sizes[] = {1, 2, 3, 8, 33};
+	const unsigned counts[] = {0, 1, 2, 7, 1000};
+
+	for(unsigned s(0); s != 5; ++s) {
+		ThreadPool pool(sizes[s]);
+		CHECK(pool.size() == sizes[s]);
+
+		for(unsigned c(0); c != 5; ++c) {
+			const unsigned N(counts[c]);
+			std::unique_ptr<std::atomic<unsigned>[]> runs(
+				new std::atomic<unsigned>[N + 1]);
+			std::atomic<unsigned> bad_worker(0);
+
+			for(unsigned i(0); i != N; ++i)
+				runs[i] = 0;
+
+			// uneven items, so that workers steal
+			pool.parallelFor(N, [&](const unsigned i, const unsigned worker) {
+				++runs[i];
+				if(worker >= pool.size())
+					++bad_worker;
+				if(i % 7 == 0)
+					for(volatile unsigned spin(0); spin != 20000; ++spin);
+			});
+
+			unsigned once(0);
+			for(unsigned i(0); i != N; ++i)
+				once += runs[i] == 1;
+
+			CHECK(once == N);
+			CHECK(bad_worker == 0);
+		}
+	}
+
+	return test::failures();
+}